@@ -22,6 +22,7 @@
 #include <string>
 #include <iostream>
 #include <stdio.h>
+#include <stdlib.h>
 #include <json/json.h>
 #include <QtScript>
 
@@ -33,11 +34,13 @@ using namespace LCD;
 CFG::CFG() {
     main_root_ = true;
     root_ = NULL;
+    dir_ = ".";
 }
 
 CFG::CFG(Json::Value *config) {
     main_root_ = false;
     root_ = config;
+    dir_ = ".";
 }
 
 CFG::~CFG() {
@@ -71,6 +74,14 @@ bool CFG::CFG_Init( std::string path ) {
        text = buffer;
     delete []buffer;
     fclose(file);
+    char *real = realpath(path.c_str(), NULL);
+    if(real) {
+        dir_ = real;
+        dir_ = dir_.substr(0, dir_.rfind('/'));
+        if(dir_.empty())
+            dir_ = "/";
+        free(real);
+    }
     root_ = new Json::Value();
     bool r = reader_.parse( text, *root_ );
     if( r ) {
@@ -32,6 +32,7 @@ class CFG : public virtual Evaluator {
     Json::Reader reader_;
     Json::Value *root_;
     bool main_root_;
+    std::string dir_;
     protected:
     std::string key_;
     public:
@@ -40,6 +41,8 @@ class CFG : public virtual Evaluator {
     virtual ~CFG();
     std::string CFG_Source();
     bool CFG_Init( std::string path);
+    // Directory the config was read from, for paths relative to it.
+    std::string CFG_Dir() { return dir_; }
     Json::Value *CFG_Fetch_Raw(Json::Value *section, std::string key, 
         Json::Value *defval = NULL);
     Json::Value *CFG_Fetch(Json::Value *section, std::string key, 
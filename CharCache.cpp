@@ -0,0 +1,270 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CharCache.h"
+#include "LCDText.h"
+#include "debug.h"
+
+using namespace LCD;
+
+CharCache::CharCache(LCDText *lcd) {
+    lcd_ = lcd;
+    clock_ = 0;
+    uploads_ = 0;
+    plan_ = -1;
+}
+
+void CharCache::Resize(int chars) {
+    if(chars == (int)slots_.size())
+        return;
+
+    Slot empty;
+    empty.refs = 0;
+    empty.shared = false;
+    empty.loaded = false;
+    empty.used = 0;
+    empty.hash = 0;
+    empty.device_hash = 0;
+    slots_.assign(chars < 0 ? 0 : chars, empty);
+    lcd_->special_chars.assign(slots_.size(), SpecialChar());
+    plans_.clear();
+    plan_index_.clear();
+    plan_ = -1;
+}
+
+// A resident slot holding glyph that the caller may take: any unreferenced
+// one, or a referenced one when both sides share.
+int CharCache::Find(const SpecialChar &glyph, unsigned int hash, bool shared) {
+    for(unsigned int i = 0; i < slots_.size(); i++) {
+        Slot &slot = slots_[i];
+        if(slot.hash != hash || (slot.refs > 0 && !(shared && slot.shared)))
+            continue;
+        if(lcd_->special_chars[i] == glyph)
+            return i;
+    }
+    return -1;
+}
+
+// The current plan's slot for a shared glyph, if it is free.
+int CharCache::Home(const SpecialChar &glyph) {
+    if(plan_ < 0)
+        return -1;
+    Plan &plan = plans_[plan_];
+    for(unsigned int i = 0; i < plan.glyphs.size(); i++) {
+        int slot = plan.home[i];
+        if(slot >= 0 && slots_[slot].refs == 0 && plan.glyphs[i] == glyph)
+            return slot;
+    }
+    return -1;
+}
+
+// Unreferenced slot to overwrite: outside the current layout's plan
+// first, then outside the next one's, then least recently used.
+int CharCache::Victim() {
+    std::vector<bool> none;
+    const std::vector<bool> &current = plan_ < 0 ? none : 
+        plans_[plan_].reserved;
+    const std::vector<bool> &next = plan_ < 0 ? none :
+        plans_[(plan_ + 1) % plans_.size()].reserved;
+    int victim = -1, best = 0;
+
+    for(unsigned int i = 0; i < slots_.size(); i++) {
+        if(slots_[i].refs > 0)
+            continue;
+        int score = 0;
+        if(!current.empty() && current[i])
+            score = 2;
+        else if(!next.empty() && next[i])
+            score = 1;
+        if(victim < 0 || score < best || 
+            (score == best && slots_[i].used < slots_[victim].used)) {
+            victim = i;
+            best = score;
+        }
+    }
+    return victim;
+}
+
+// Returns the slot now holding glyph, or -1 when every slot is referenced.
+// Private slots are for widgets that redraw their glyphs in place.
+int CharCache::Acquire(const SpecialChar &glyph, bool shared) {
+    unsigned int hash = glyph.Hash();
+    int victim = Find(glyph, hash, shared);
+
+    if(victim < 0) {
+        if(shared)
+            victim = Home(glyph);
+        if(victim < 0)
+            victim = Victim();
+        if(victim < 0)
+            return -1;
+        lcd_->special_chars[victim] = glyph;
+        slots_[victim].hash = hash;
+    }
+
+    Slot &slot = slots_[victim];
+    slot.shared = shared;
+    slot.refs++;
+    slot.used = ++clock_;
+    return victim;
+}
+
+void CharCache::Release(int slot) {
+    if(slot < 0 || slot >= (int)slots_.size() || slots_[slot].refs == 0)
+        return;
+    slots_[slot].refs--;
+}
+
+void CharCache::ReleaseAll() {
+    for(unsigned int i = 0; i < slots_.size(); i++)
+        slots_[i].refs = 0;
+}
+
+// Push a slot to the device if its bitmap changed since the last upload.
+bool CharCache::Sync(int ch) {
+    if(ch < 0 || ch >= (int)slots_.size())
+        return false;
+
+    Slot &slot = slots_[ch];
+    SpecialChar &glyph = lcd_->special_chars[ch];
+    if(glyph.Size() == 0)
+        return false;           /* never assigned */
+    slot.hash = glyph.Hash();
+    slot.used = ++clock_;
+    if(slot.loaded && slot.device_hash == slot.hash && slot.device == glyph)
+        return false;
+
+    if(!lcd_->TextRealDefChar) {
+        LCDError("LCDText: No TextRealDefChar");
+        return false;
+    }
+    lcd_->TextRealDefChar(lcd_, ch, glyph);
+    slot.device = glyph;
+    slot.device_hash = slot.hash;
+    slot.loaded = true;
+    uploads_++;
+    return true;
+}
+
+// The device lost its CGRAM, e.g. after a reconnect.
+void CharCache::Invalidate() {
+    for(unsigned int i = 0; i < slots_.size(); i++)
+        slots_[i].loaded = false;
+}
+
+int CharCache::InUse() {
+    int n = 0;
+    for(unsigned int i = 0; i < slots_.size(); i++) {
+        if(slots_[i].refs > 0)
+            n++;
+    }
+    return n;
+}
+
+static int SlotScore(bool known, const SpecialChar &content, 
+    const std::vector<SpecialChar> &next) {
+    if(!known)
+        return 0;
+    for(unsigned int i = 0; i < next.size(); i++) {
+        if(next[i] == content)
+            return 2;
+    }
+    return 1;
+}
+
+// Lay out glyphs for the layout rotation, in order. Each layout starts
+// from the slots its predecessor left behind; the rotation is walked twice
+// so the first layout sees what the last one leaves.
+void CharCache::SetPlans(std::vector<Plan> plans) {
+    int nslots = slots_.size();
+    int n = plans.size();
+    std::vector<SpecialChar> state(nslots);
+    std::vector<bool> known(nslots, false);
+
+    for(int pass = 0; pass < 2; pass++) {
+        for(int i = 0; i < n; i++) {
+            Plan &plan = plans[i];
+            const std::vector<SpecialChar> &next = plans[(i + 1) % n].glyphs;
+
+            plan.home.assign(plan.glyphs.size(), -1);
+            plan.reserved.assign(nslots, false);
+            plan.uploads = 0;
+            std::vector<bool> taken(nslots, false);
+
+            /* glyphs already in place stay there */
+            for(unsigned int g = 0; g < plan.glyphs.size(); g++) {
+                for(int s = 0; s < nslots; s++) {
+                    if(known[s] && !taken[s] && state[s] == plan.glyphs[g]) {
+                        plan.home[g] = s;
+                        plan.reserved[s] = taken[s] = true;
+                        break;
+                    }
+                }
+            }
+
+            /* the rest, then private glyphs, go where they hurt least */
+            int wanted = plan.glyphs.size() + plan.privates;
+            for(int g = 0; g < wanted; g++) {
+                bool priv = g >= (int)plan.glyphs.size();
+                if(!priv && plan.home[g] >= 0)
+                    continue;
+                int slot = -1, best = 0;
+                for(int s = 0; s < nslots; s++) {
+                    if(taken[s])
+                        continue;
+                    int score = SlotScore(known[s], state[s], next);
+                    if(slot < 0 || score < best) {
+                        slot = s;
+                        best = score;
+                    }
+                }
+                if(slot < 0)
+                    break;
+                plan.uploads++;
+                taken[slot] = true;
+                if(priv) {
+                    known[slot] = false;
+                    continue;
+                }
+                plan.home[g] = slot;
+                plan.reserved[slot] = true;
+                state[slot] = plan.glyphs[g];
+                known[slot] = true;
+            }
+        }
+    }
+
+    plans_ = plans;
+    plan_index_.clear();
+    for(int i = 0; i < n; i++)
+        plan_index_[plans_[i].layout] = i;
+    plan_ = -1;
+}
+
+void CharCache::SelectPlan(std::string layout) {
+    std::map<std::string, int>::iterator it = plan_index_.find(layout);
+    plan_ = it == plan_index_.end() ? -1 : it->second;
+}
+
+int CharCache::PlannedUploads(std::string layout) {
+    std::map<std::string, int>::iterator it = plan_index_.find(layout);
+    return it == plan_index_.end() ? -1 : plans_[it->second].uploads;
+}
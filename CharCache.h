@@ -0,0 +1,101 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CHAR_CACHE_H__
+#define __CHAR_CACHE_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SpecialChar.h"
+
+namespace LCD {
+
+class LCDText;
+
+/*
+ * Tracks what each CGRAM slot of a text display holds. Glyphs are keyed
+ * by content hash: a shared glyph already resident is handed out again
+ * with its reference count bumped, and a slot nobody references keeps
+ * its glyph until it is reused, least recently used first. Sync only
+ * calls TextRealDefChar when a slot's bitmap differs from what the
+ * device was last sent.
+ *
+ * Given the layout rotation, Plan gives every static glyph of a layout a
+ * home slot, keeping glyphs that consecutive layouts share where they
+ * already are. Private glyphs and evictions then avoid slots the current
+ * and next layout rely on.
+ */
+class CharCache {
+
+    typedef struct _Slot {
+        int refs;
+        bool shared;
+        bool loaded;
+        unsigned long used;
+        unsigned int hash;
+        unsigned int device_hash;
+        SpecialChar device;
+    } Slot;
+
+    public:
+    typedef struct _Plan {
+        std::string layout;
+        std::vector<SpecialChar> glyphs;    // shared glyphs, deduplicated
+        int privates;
+        std::vector<int> home;              // slot per glyph, -1 if none
+        std::vector<bool> reserved;         // slot holds one of glyphs
+        int uploads;                        // expected on switching in
+    } Plan;
+
+    private:
+
+    LCDText *lcd_;
+    std::vector<Slot> slots_;
+    unsigned long clock_;
+    unsigned long uploads_;
+    std::vector<Plan> plans_;
+    std::map<std::string, int> plan_index_;
+    int plan_;
+
+    int Find(const SpecialChar &glyph, unsigned int hash, bool shared);
+    int Home(const SpecialChar &glyph);
+    int Victim();
+
+    public:
+    CharCache(LCDText *lcd);
+    void Resize(int chars);
+    int Acquire(const SpecialChar &glyph, bool shared);
+    void Release(int slot);
+    void ReleaseAll();
+    bool Sync(int slot);
+    void Invalidate();
+    int InUse();
+    unsigned long Uploads() { return uploads_; }
+    void SetPlans(std::vector<Plan> plans);
+    void SelectPlan(std::string layout);
+    int PlannedUploads(std::string layout);
+};
+
+}; // End namespace
+
+#endif
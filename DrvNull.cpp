@@ -0,0 +1,142 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "DrvNull.h"
+#include "SpecialChar.h"
+
+using namespace LCD;
+
+static const char *flush_stages[TEXT_FLUSH_STAGES] = {
+    "composite", "plan", "display copy"
+};
+
+// Constructor
+DrvNull::DrvNull(std::string name, LCDControl *v,
+    Json::Value *config, int rows, int cols, int layers) :
+    LCDCore(v, name, config, LCD_TEXT, (LCDText *)this),
+    LCDText((LCDCore *)this) {
+
+    rows_ = rows > 0 ? rows : 4;
+    cols_ = cols > 0 ? cols : 20;
+
+    Json::Value *val = CFG_Fetch(config, name + ".goto-cost", new Json::Value(3));
+    int goto_cost = val->asInt();
+    delete val;
+
+    val = CFG_Fetch(config, name + ".packet-cost", new Json::Value(0));
+    PACKET_COST = val->asInt();
+    delete val;
+
+    val = CFG_Fetch(config, name + ".baud", new Json::Value(0));
+    int baud = val->asInt();
+    delete val;
+
+    val = CFG_Fetch(config, name + ".report", new Json::Value(5000));
+    int report = val->asInt();
+    delete val;
+
+    stats_ = new NullStats(name, "cells", baud, report);
+    screen_.assign(rows_ * cols_, ' ');
+
+    TextRealBlit = DrvBlit;
+    TextRealBlitBatch = DrvBlitBatch;
+    TextRealDefChar = DrvDefChar;
+    TextTimeFlushes(true);
+
+    TextInit(rows_, cols_, 8, 5, goto_cost, 8, 0, layers);
+}
+
+// Destructor
+DrvNull::~DrvNull() {
+    delete stats_;
+}
+
+// Copy a span into the screen; returns the bytes it would cost.
+int DrvNull::DrvWrite(int row, int col, const unsigned char *data, int len) {
+    if(row < 0 || row >= rows_ || col < 0 || col >= cols_)
+        return 0;
+    if(col + len > cols_)
+        len = cols_ - col;
+    memcpy(&screen_[row * cols_ + col], data, len);
+    return GOTO_COST + PACKET_COST + len;
+}
+
+// Unbatched spans (clears, scrolls) are traffic but not frames.
+void DrvNull::DrvBlit(LCDText *obj, int row, int col,
+    unsigned char *data, int len) {
+    DrvNull *lcd = static_cast<DrvNull *>(obj);
+    lcd->stats_->Begin();
+    int bytes = lcd->DrvWrite(row, col, data, len);
+    lcd->stats_->Wire(len, bytes, false);
+    lcd->stats_->End();
+}
+
+// One flush is one frame.
+void DrvNull::DrvBlitBatch(LCDText *obj, const TextSpan *spans, int count) {
+    DrvNull *lcd = static_cast<DrvNull *>(obj);
+    int cells = 0, bytes = 0;
+    lcd->stats_->Begin();
+    for(int i = 0; i < count; i++) {
+        bytes += lcd->DrvWrite(spans[i].row, spans[i].col, spans[i].data,
+            spans[i].len);
+        cells += spans[i].len;
+    }
+    lcd->stats_->Wire(cells, bytes);
+    for(int s = 0; s < TEXT_FLUSH_STAGES; s++)
+        lcd->stats_->Pipeline(flush_stages[s], lcd->TextFlushTime(s));
+    lcd->stats_->Counter("char uploads", lcd->TextCharUploads());
+    lcd->stats_->End();
+}
+
+// A glyph upload is a command plus one byte per pixel row.
+void DrvNull::DrvDefChar(LCDText *obj, const int ascii, SpecialChar matrix) {
+    DrvNull *lcd = static_cast<DrvNull *>(obj);
+    lcd->stats_->Begin();
+    lcd->stats_->Wire(0, lcd->GOTO_COST + lcd->PACKET_COST + lcd->YRES,
+        false);
+    lcd->stats_->End();
+}
+
+// Initialize device
+void DrvNull::SetupDevice() {
+}
+
+// Deinit driver
+void DrvNull::TakeDown() {
+    Disconnect();
+}
+
+// Configuration setup
+void DrvNull::CFGSetup() {
+    LCDCore::CFGSetup();
+}
+
+// Connect -- generic method called from main code
+void DrvNull::Connect() {
+    TextClear();
+}
+
+// Disconnect -- deinit
+void DrvNull::Disconnect() {
+    stats_->Flush();
+}
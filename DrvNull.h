@@ -0,0 +1,72 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DRV_NULL_H__
+#define __DRV_NULL_H__
+
+#include <string>
+#include <vector>
+
+#include "LCDText.h"
+#include "LCDCore.h"
+#include "LCDControl.h"
+#include "NullStats.h"
+#include "debug.h"
+
+namespace LCD {
+
+/*
+ * Text display with no device behind it. Spans are copied into an
+ * in-memory screen and counted, with GOTO_COST and PACKET_COST charged
+ * per span as a serial panel would pay them, so everything above the
+ * driver can be measured without hardware. With a baud rate each flush
+ * blocks for its transfer time; without one the driver runs uncapped.
+ */
+class DrvNull : public LCDCore, public LCDText {
+
+    NullStats *stats_;
+    std::vector<unsigned char> screen_;
+    int rows_;
+    int cols_;
+
+    static void DrvBlit(LCDText *obj, int row, int col,
+        unsigned char *data, int len);
+    static void DrvBlitBatch(LCDText *obj, const TextSpan *spans,
+        int count);
+    static void DrvDefChar(LCDText *obj, const int ascii,
+        SpecialChar matrix);
+    int DrvWrite(int row, int col, const unsigned char *data, int len);
+
+    public:
+    DrvNull(std::string name, LCDControl *v,
+        Json::Value *config, int rows, int cols, int layers);
+    ~DrvNull();
+    void SetupDevice();
+    void TakeDown();
+    void CFGSetup();
+    void Connect();
+    void Disconnect();
+    const unsigned char *Screen() { return &screen_[0]; }
+};
+
+}; // End namespace
+
+#endif
@@ -0,0 +1,152 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "DrvNullGraphic.h"
+#include "GraphicPack.h"
+
+using namespace LCD;
+
+static const char *flush_stages[FLUSH_STAGES] = {
+    "merge", "composite", "damage", "publish", "pack"
+};
+
+// Constructor
+DrvNullGraphic::DrvNullGraphic(std::string name, LCDControl *v,
+    Json::Value *config, int rows, int cols, int layers) :
+    LCDCore(v, name, config, LCD_GRAPHIC, (LCDGraphic *)this),
+    LCDGraphic((LCDCore *)this), stride_(0), rows_(0), cols_(0) {
+
+    int drows = rows > 0 ? rows : 64;
+    int dcols = cols > 0 ? cols : 256;
+
+    Json::Value *val = CFG_Fetch_Raw(config, name + ".format",
+        new Json::Value("xrgb8888"));
+    std::string format = val->asString();
+    delete val;
+    if(format == "rgb565")
+        PIXEL_FORMAT = GRAPHIC_RGB565;
+    else if(format == "gray8")
+        PIXEL_FORMAT = GRAPHIC_GRAY8;
+    else if(format == "gray4")
+        PIXEL_FORMAT = GRAPHIC_GRAY4;
+    else if(format == "mono-page")
+        PIXEL_FORMAT = GRAPHIC_MONO_PAGE;
+    else if(format == "mono-row")
+        PIXEL_FORMAT = GRAPHIC_MONO_ROW;
+    else {
+        if(format != "xrgb8888")
+            LCDError("%s: ignoring unknown format '%s'",
+                name.c_str(), format.c_str());
+        PIXEL_FORMAT = GRAPHIC_XRGB8888;
+    }
+
+    val = CFG_Fetch(config, name + ".packet-cost", new Json::Value(0));
+    packet_cost_ = val->asInt();
+    delete val;
+
+    val = CFG_Fetch(config, name + ".baud", new Json::Value(0));
+    int baud = val->asInt();
+    delete val;
+
+    val = CFG_Fetch(config, name + ".report", new Json::Value(5000));
+    int report = val->asInt();
+    delete val;
+
+    stats_ = new NullStats(name, "pixels", baud, report);
+
+    GraphicRealBlitRects = DrvBlitRects;
+    GraphicTimeFlushes(true);
+
+    GraphicInit(drows, dcols, 8, 6, layers);
+}
+
+// Destructor
+DrvNullGraphic::~DrvNullGraphic() {
+    delete stats_;
+}
+
+// One flush is one frame. Rectangles come in device coordinates,
+// aligned to whole bytes of the format.
+void DrvNullGraphic::DrvBlitRects(LCDGraphic *obj, const GraphicRect *rects,
+    int count) {
+    DrvNullGraphic *lcd = static_cast<DrvNullGraphic *>(obj);
+    int format = lcd->PIXEL_FORMAT;
+    int pixels = 0, bytes = 0;
+
+    lcd->stats_->Begin();
+    if(lcd->rows_ != lcd->DROWS || lcd->cols_ != lcd->DCOLS) {
+        lcd->rows_ = lcd->DROWS;
+        lcd->cols_ = lcd->DCOLS;
+        lcd->stride_ = GraphicPackStride(format, lcd->cols_);
+        lcd->frame_.assign(lcd->stride_ *
+            GraphicPackLines(format, lcd->rows_), 0);
+    }
+    for(int i = 0; i < count; i++) {
+        const GraphicRect &rect = rects[i];
+        if(rect.row + rect.height > lcd->rows_ ||
+            rect.col + rect.width > lcd->cols_)
+            continue;
+        uint8_t *dst = &lcd->frame_[GraphicPackOffset(format, rect.row,
+            rect.col, lcd->stride_)];
+        int lines = GraphicPackLines(format, rect.height);
+        for(int l = 0; l < lines; l++)
+            memcpy(dst + l * lcd->stride_, rect.data + l * rect.stride,
+                rect.stride);
+        pixels += rect.height * rect.width;
+        bytes += lcd->packet_cost_ + lines * rect.stride;
+    }
+    lcd->stats_->Wire(pixels, bytes);
+    for(int s = 0; s < FLUSH_STAGES; s++)
+        lcd->stats_->Pipeline(flush_stages[s], lcd->GraphicFlushTime(s));
+    lcd->stats_->Counter("tiles hashed", lcd->GraphicTilesHashed());
+    lcd->stats_->Counter("tiles skipped", lcd->GraphicTilesSkipped());
+    lcd->stats_->Counter("rows flattened", lcd->GraphicRowsFlattened());
+    lcd->stats_->Counter("rows cached", lcd->GraphicRowsCached());
+    lcd->stats_->Counter("frames published", lcd->GraphicFramesPublished());
+    lcd->stats_->End();
+}
+
+// Initialize device
+void DrvNullGraphic::SetupDevice() {
+    GraphicStart();
+}
+
+// Deinit driver
+void DrvNullGraphic::TakeDown() {
+    Disconnect();
+}
+
+// Configuration setup
+void DrvNullGraphic::CFGSetup() {
+    LCDCore::CFGSetup();
+}
+
+// Connect -- generic method called from main code
+void DrvNullGraphic::Connect() {
+    GraphicClear();
+}
+
+// Disconnect -- deinit
+void DrvNullGraphic::Disconnect() {
+    stats_->Flush();
+}
@@ -0,0 +1,70 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DRV_NULL_GRAPHIC_H__
+#define __DRV_NULL_GRAPHIC_H__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "LCDGraphic.h"
+#include "LCDCore.h"
+#include "LCDControl.h"
+#include "NullStats.h"
+#include "debug.h"
+
+namespace LCD {
+
+/*
+ * Graphic display with no device behind it. Every flush arrives through
+ * GraphicRealBlitRects packed in PIXEL_FORMAT, is copied into an
+ * in-memory frame and counted, PACKET_COST bytes charged per rectangle
+ * for the window command a panel would need. As with DrvNull, a baud
+ * rate makes each flush wait out its transfer time.
+ */
+class DrvNullGraphic : public LCDCore, public LCDGraphic {
+
+    NullStats *stats_;
+    std::vector<uint8_t> frame_;
+    int stride_;
+    int rows_;
+    int cols_;
+    int packet_cost_;
+
+    static void DrvBlitRects(LCDGraphic *obj, const GraphicRect *rects,
+        int count);
+
+    public:
+    DrvNullGraphic(std::string name, LCDControl *v,
+        Json::Value *config, int rows, int cols, int layers);
+    ~DrvNullGraphic();
+    void SetupDevice();
+    void TakeDown();
+    void CFGSetup();
+    void Connect();
+    void Disconnect();
+    const uint8_t *Frame() { return &frame_[0]; }
+};
+
+}; // End namespace
+
+#endif
@@ -20,27 +20,66 @@
  */
 
 #include <iostream>
-#include <Magick++.h>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "DrvSDL.h"
 using namespace std;
 using namespace LCD;
 
-// LCDGraphic RealBlit
-void DrvSDLBlit(LCDGraphic *lcd, const int row, const int col,
-    const int height, const int width) {
-    ((DrvSDL *)lcd)->DrvBlit(row, col, height, width);
-}
+// Repeat each of len pixels scale times.
+static void ScaleRow(const uint32_t *src, uint32_t *dst, int len, int scale) {
+    int n = 0;
+
+    if(scale == 1) {
+        memcpy(dst, src, len * sizeof(uint32_t));
+        return;
+    }
+
+#if defined(__SSE2__)
+    for(; n + 4 <= len && scale >= 2 && scale <= 4; n += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + n));
+        __m128i *out = (__m128i *)(dst + n * scale);
+        switch(scale) {
+        case 2:
+            _mm_storeu_si128(out, _mm_unpacklo_epi32(v, v));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(v, v));
+            break;
+        case 3:
+            _mm_storeu_si128(out, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 0, 0)));
+            _mm_storeu_si128(out + 1, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 1, 1)));
+            _mm_storeu_si128(out + 2, _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 2)));
+            break;
+        case 4:
+            _mm_storeu_si128(out, _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 0, 0, 0)));
+            _mm_storeu_si128(out + 1, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 1, 1)));
+            _mm_storeu_si128(out + 2, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 2, 2)));
+            _mm_storeu_si128(out + 3, _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)));
+            break;
+        }
+    }
+#endif
 
+    for(; n < len; n++)
+        for(int i = 0; i < scale; i++)
+            dst[n * scale + i] = src[n];
+}
 
 // Constructor
 DrvSDL::DrvSDL(std::string name, LCDControl *v,
     Json::Value *config, int layers) :
     LCDCore(v, name, config, LCD_GRAPHIC, (LCDGraphic *)this),
-    LCDGraphic((LCDCore *)this), drvFB(0) {
+    LCDGraphic((LCDCore *)this), frame_(NULL), redraw_(false),
+    recorder_(NULL) {
 
-    GraphicRealBlit = DrvSDLBlit;
+    // Frames are presented from the SDL timer, not the update thread.
+    FRAME_QUEUE = true;
+    PIXEL_FORMAT = GRAPHIC_XRGB8888;
 
     Json::Value *val = CFG_Fetch(config, name + ".cols", new Json::Value(SCREEN_W));
     cols_ = val->asInt();
@@ -72,13 +111,13 @@ DrvSDL::DrvSDL(std::string name, LCDControl *v,
 
     gettimeofday(&gif_last_update_, NULL);
 
+    if(gif_file_ != "")
+        recorder_ = new GifRecorder(gif_file_, pixels.x, pixels.y);
+
 cout << rows_ << " " << cols_ << "--------------------------------------\n";
 
     GraphicInit(rows_, cols_, 8, 7, layers);
 
-    if(!(drvFB = (RGBA *)malloc(rows_ * pixels.y * cols_ * pixels.x * sizeof(RGBA))))
-	LCDError("Could not allocate frame buffer for DrvSDL");
-
     wrapper_ = new SDLWrapper((SDLInterface *)this);
 
     update_thread_ = new SDLUpdateThread(this);
@@ -110,49 +149,20 @@ cout << rows_ << " " << cols_ << "--------------------------------------\n";
 // Destructor
 DrvSDL::~DrvSDL() {
     update_thread_->wait();
-    if(drvFB) {free(drvFB); drvFB = NULL;}
     delete wrapper_;
     delete update_thread_;
     SDL_Quit();
-    if(gif_file_ != "" && !image_.empty()) {
-        WriteGif();
-    }
-}
-
-void DrvSDL::WriteGif() {
-    std::list<Magick::Image> gif;
-
-    int num = 0;
-    for(std::list<Magick::Blob>::iterator it = image_.begin(); it != image_.end(); it++) {
-        Magick::Image image;
-        image.magick("RGB");
-        image.depth(32);
-        image.size(Magick::Geometry(cols_ * pixels.x, rows_ * pixels.y));
-        Magick::PixelPacket *pixel_cache = image.getPixels(0, 0, cols_ * pixels.x, rows_ * pixels.y);
-        for(int n = 0; n < rows_ * pixels.y * cols_ * pixels.x; n++) {
-            int col = ((int *)(*it).data())[n];
-            uint8_t *rgb = (uint8_t *) &col;
-            Magick::PixelPacket *gif_pixel = pixel_cache + n;
-            *gif_pixel = Magick::ColorRGB(rgb[0] / 256.0, rgb[1] / 256.0, rgb[2] / 256.0);
-        }
-        image.syncPixels();
-        gif.push_back(image);
-        LCDInfo("Image %d", num++);
+    if(recorder_) {
+        recorder_->Stop();
+        delete recorder_;
     }
-    LCDInfo("Writing GIF image...");
-    for_each(gif.begin(), gif.end(), Magick::animationDelayImage(ani_speed_ / 10));
-    Magick::writeImages(gif.begin(), gif.end(), gif_file_);
 }
 
+// Hand the frame on screen to the recorder; it keeps only changes.
 void DrvSDL::DrvUpdateGif() {
-    if( SDL_MUSTLOCK(surface_))
-        if(SDL_LockSurface(surface_) < 0)
-            return;
-
-    image_.push_back(Magick::Blob(surface_->pixels, rows_ * pixels.y * surface_->pitch));
-
-    if(SDL_MUSTLOCK(surface_))
-        SDL_UnlockSurface(surface_);
+    if(recorder_ && frame_)
+        recorder_->Capture((const uint32_t *)&frame_->data[0],
+            frame_->rows, frame_->cols, frame_->stride);
 }
 
 // Initialize device
@@ -176,8 +186,10 @@ void DrvSDL::CFGSetup() {
 void DrvSDL::Connect() {
     DrvClear();
     update_thread_->start();
-    if(gif_file_ != "") 
+    if(recorder_) {
+        recorder_->start();
         gif_timer_.start();
+    }
     sdl_timer_.start();
 }
 
@@ -194,7 +206,6 @@ void DrvSDL::UpdateThread() {
 
 void DrvSDL::DrvUpdateSDL() {
         DrvUpdateImg();
-        SDL_Flip(surface_);
         SDL_Event event;
         while(SDL_PollEvent(&event)) {
             switch(event.type) {
@@ -224,6 +235,9 @@ void DrvSDL::DrvUpdateSDL() {
                 Disconnect();
                 GetApp()->Stop();
                 break;
+            case SDL_VIDEOEXPOSE:
+                redraw_ = true;
+                break;
             case SDL_VIDEORESIZE:
                 LCDInfo("Resize %dx%d", event.resize.w, event.resize.h);
                 Resize(event.resize.h, event.resize.w);
@@ -245,38 +259,66 @@ void DrvSDL::UnlockSDL() {
         SDL_UnlockSurface(surface_);
 }
 
+// Draw what changed since the last frame shown, scaled straight into
+// the surface, and update only those rectangles.
 void DrvSDL::DrvUpdateImg() {
+    const GraphicFrames::Frame *frame = GraphicAcquireFrame();
+    std::vector<GraphicRect> all;
+    const std::vector<GraphicRect> *rects;
+
+    if(frame) {
+        frame_ = frame;
+        rects = &frame->damage;
+    } else if(!redraw_ || !frame_) {
+        return;
+    }
+    if(redraw_ || !frame) {
+        GraphicRect rect = { 0, 0, frame_->rows, frame_->cols, NULL, 0 };
+        all.push_back(rect);
+        rects = &all;
+    }
+    redraw_ = false;
+
     if(LockSDL() < 0)
         return;
 
-    for(int r = 0; r < rows_; r++) {
-        for(int c = 0; c < cols_; c++) {
-            SDL_Rect rect;
-            rect.y = r * pixels.y;
-            rect.x = c * pixels.x;
-            rect.h = pixels.y;
-            rect.w = pixels.x;
-            RGBA rgb = drvFB[r * cols_ + c];
-            int col = (256 << 24) + (rgb.R << 16) + (rgb.G << 8) + rgb.B;
-            SDL_FillRect(surface_, &rect, col);
-        }
+    updates_.clear();
+    for(unsigned int i = 0; i < rects->size(); i++) {
+        const GraphicRect &rect = (*rects)[i];
+        int rows = min(min(rows_, frame_->rows), rect.row + rect.height);
+        int cols = min(min(cols_, frame_->cols), rect.col + rect.width);
+        if(rect.row >= rows || rect.col >= cols)
+            continue;
+        DrvScaleRect(rect.row, rect.col, rows - rect.row, cols - rect.col);
+        SDL_Rect update;
+        update.x = rect.col * pixels.x;
+        update.y = rect.row * pixels.y;
+        update.w = (cols - rect.col) * pixels.x;
+        update.h = (rows - rect.row) * pixels.y;
+        updates_.push_back(update);
     }
-    
+
     UnlockSDL();
 
-    SDL_UpdateRect(surface_, 0, 0, cols_ * pixels.x, rows_ * pixels.y);
+    if(!updates_.empty())
+        SDL_UpdateRects(surface_, updates_.size(), &updates_[0]);
 }
 
-// Driver-side blit method
-void DrvSDL::DrvBlit(const int row, const int col, 
-    const int height, const int width) {
-    mutex_.lock();
+// Scale a window of the frame on screen into the surface: each row once,
+// then copied down for the rest of its pixel's height.
+void DrvSDL::DrvScaleRect(int row, int col, int height, int width) {
+    uint8_t *pixels_out = (uint8_t *)surface_->pixels;
+    int pitch = surface_->pitch;
+    int bytes = width * pixels.x * sizeof(uint32_t);
     for(int r = row; r < row + height; r++) {
-        for(int c = col; c < col + width; c++) {
-            drvFB[r * cols_ + c] = GraphicRGB(r, c);
-        }
+        const uint32_t *src =
+            (const uint32_t *)&frame_->data[r * frame_->stride] + col;
+        uint8_t *dst = pixels_out + r * pixels.y * pitch +
+            col * pixels.x * sizeof(uint32_t);
+        ScaleRow(src, (uint32_t *)dst, width, pixels.x);
+        for(int y = 1; y < pixels.y; y++)
+            memcpy(dst + y * pitch, dst, bytes);
     }
-    mutex_.unlock();
 }
 
 // Clear the LCD
@@ -292,23 +334,17 @@ int DrvSDL::IsFullScreen() {
 
 void DrvSDL::ToggleFullScreen() {
     SDL_WM_ToggleFullScreen( surface_ );
+    redraw_ = true;
     SDL_ShowCursor( IsFullScreen() ? SDL_DISABLE : SDL_ENABLE );
 }
 
 void DrvSDL::Resize(const int rows, const int cols) {
-    mutex_.lock();
-    RGBA *tmp = (RGBA *)realloc(drvFB, 
-        rows * cols * sizeof(RGBA));
-    if(!tmp) {
-        LCDError("DrvSDL: Unable to reallocate buffer");
-        return;
-    }
-    drvFB = tmp;
     emit static_cast<LCDEvents *>(visitor_->GetWrapper())->_ResizeBefore(rows, cols);
     LockSDL();
     SDL_FreeSurface(surface_);
     surface_ = SDL_SetVideoMode(cols, rows, 32, SDL_RESIZABLE);
     UnlockSDL();
+    redraw_ = true;
     if(!surface_) {
         LCDError("Unable to resize SDL surface");
         sdl_timer_.stop();
@@ -318,6 +354,5 @@ void DrvSDL::Resize(const int rows, const int cols) {
     if(visitor_->ResizeLCD(rows / pixels.y, cols / pixels.x) == 0) {
         emit static_cast<LCDEvents *>(visitor_->GetWrapper())->_ResizeAfter();
     }
-    mutex_.unlock();
 }
 
@@ -9,7 +9,6 @@
 #include <list>
 #include <vector>
 #include <SDL.h>
-#include <Magick++.h>
 #include <sys/time.h>
 
 
@@ -17,6 +16,7 @@
 #include "LCDCore.h"
 #include "LCDControl.h"
 #include "RGBA.h"
+#include "GifRecorder.h"
 #include "debug.h"
 
 #define SCREEN_H 64
@@ -50,14 +50,15 @@ class DrvSDL : public LCDCore, public LCDGraphic,
 
     SDLWrapper *wrapper_;
     SDLUpdateThread *update_thread_;
-    RGBA *drvFB;
-    //std::vector<RGBA> drvFB;
+    // Frame on screen, owned until the next GraphicAcquireFrame.
+    const GraphicFrames::Frame *frame_;
+    bool redraw_;
+    std::vector<SDL_Rect> updates_;
 
-    QMutex mutex_;
     QTimer gif_timer_;
     QTimer sdl_timer_;
 
-    std::list<Magick::Blob> image_;
+    GifRecorder *recorder_;
 
     bool connected_;
     int update_;
@@ -71,6 +72,7 @@ class DrvSDL : public LCDCore, public LCDGraphic,
 
     void DrvClear();
     void DrvUpdateImg();
+    void DrvScaleRect(int row, int col, int height, int width);
     void DrvUpdate();
 
     public:
@@ -87,11 +89,9 @@ class DrvSDL : public LCDCore, public LCDGraphic,
     void DrvUpdateSDL();
     int LockSDL();
     void UnlockSDL();
-    void WriteGif();
     int IsFullScreen();
     void ToggleFullScreen();
     void Resize(const int rows, const int cols);
-    void DrvBlit(const int row, const int col, const int height, const int width);
 
 };
 
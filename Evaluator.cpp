@@ -25,6 +25,7 @@
 
 #include "Evaluator.h"
 #include "PluginInterface.h"
+#include "PluginLoader.h"
 #include "SpecialChar.h"
 #include "debug.h"
 
@@ -70,26 +71,81 @@ Evaluator::Evaluator(QScriptEngine *engine) {
 }
 */
 
-void Evaluator::LoadPlugins() {
+/* Each function below is created with the loader as its data, and
+   the source (and column) it reads as properties of itself. */
 
-/*
-    QDir pluginsDir(qApp->applicationDirPath());
-    pluginsDir.cd("plugins");
-    foreach(string fileName, pluginsDir.entryList(QDir::Files)) {
-        QPluginLoader pluginLoader(pluginsDir.absoluteFilePath(fileName));
-        QObject *plugin = pluginLoader.instance();
-        if(plugin) {
-            PluginInterface *obj = qobject_cast<PluginInterface *>(plugin);
-            if(obj) {
-                obj->Connect(this);
-                plugins_.push_back(obj);
+static std::string SourceName(QScriptContext *ctx) {
+    return ctx->callee().property("source").toString().toStdString();
+}
+
+/* source.rows() */
+static QScriptValue SourceRows(QScriptContext *ctx, QScriptEngine *engine,
+    void *data) {
+    PluginLoader *sources = (PluginLoader *)data;
+    return QScriptValue(engine, sources->Rows(SourceName(ctx)));
+}
+
+/* source.key(row) */
+static QScriptValue SourceKey(QScriptContext *ctx, QScriptEngine *engine,
+    void *data) {
+    PluginLoader *sources = (PluginLoader *)data;
+    std::string key = sources->Key(SourceName(ctx),
+        ctx->argument(0).toInt32());
+    return QScriptValue(engine, QString(key.c_str()));
+}
+
+/* source.column(row), row being an index or a key */
+static QScriptValue SourceColumn(QScriptContext *ctx, QScriptEngine *engine,
+    void *data) {
+    PluginLoader *sources = (PluginLoader *)data;
+    std::string name = SourceName(ctx);
+    std::string column = 
+        ctx->callee().property("column").toString().toStdString();
+    QScriptValue row = ctx->argument(0);
+
+    if(sources->Type(name, column) == LCD_COLUMN_STRING) {
+        std::string str = row.isString() ?
+            sources->String(name, column, row.toString().toStdString()) :
+            sources->String(name, column, row.toInt32());
+        return QScriptValue(engine, QString(str.c_str()));
+    }
+    double num = row.isString() ?
+        sources->Number(name, column, row.toString().toStdString()) :
+        sources->Number(name, column, row.toInt32());
+    return QScriptValue(engine, num);
+}
+
+// Expose every data source as a global object with rows(), key(row)
+// and one function per column, e.g. cgroup.cpu("system.slice") or
+// procs.comm(0). Reads come from the last table SampleAll took.
+void Evaluator::AddSources(PluginLoader *sources) {
+    std::vector<std::string> names = sources->Sources();
+    for(unsigned int i = 0; i < names.size(); i++) {
+        QScriptValue source(engine_, QString(names[i].c_str()));
+        QScriptValue obj = engine_->newObject();
+
+        QScriptValue fn = engine_->newFunction(SourceRows, (void *)sources);
+        fn.setProperty("source", source);
+        obj.setProperty("rows", fn);
+        fn = engine_->newFunction(SourceKey, (void *)sources);
+        fn.setProperty("source", source);
+        obj.setProperty("key", fn);
+
+        std::vector<std::string> columns = sources->Columns(names[i]);
+        for(unsigned int c = 0; c < columns.size(); c++) {
+            if(columns[c] == "rows" || columns[c] == "key") {
+                LCDError("Source <%s>: column <%s> hidden by %s()",
+                    names[i].c_str(), columns[c].c_str(), columns[c].c_str());
+                continue;
             }
-        } else {
-            LCDError("Plugin Error: %s", 
-                pluginLoader.errorString().toStdString().c_str());
+            fn = engine_->newFunction(SourceColumn, (void *)sources);
+            fn.setProperty("source", source);
+            fn.setProperty("column",
+                QScriptValue(engine_, QString(columns[c].c_str())));
+            obj.setProperty(QString(columns[c].c_str()), fn);
         }
+        engine_->globalObject().setProperty(QString(names[i].c_str()), obj);
     }
-*/
 }
 
 Evaluator::~Evaluator() {
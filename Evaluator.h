@@ -32,9 +32,9 @@
 namespace LCD {
 
 class PluginInterface;
+class PluginLoader;
 
 class Evaluator {
-    void LoadPlugins();
     std::list<PluginInterface *> plugins_;
 
     protected:
@@ -48,6 +48,7 @@ class Evaluator {
     Evaluator();
     virtual ~Evaluator();
     virtual std::string Eval(std::string str);
+    void AddSources(PluginLoader *sources);
 /*
     void AddAccessor(std::string name, QScriptValue (*func)(QScriptContext *ctx, 
         QScriptEngine *eng), QFlags<QScriptValue::PropertyFlag>);
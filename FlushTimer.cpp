@@ -0,0 +1,48 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "FlushTimer.h"
+
+using namespace LCD;
+
+FlushTimer::FlushTimer() : enabled_(false) {
+    memset(us_, 0, sizeof(us_));
+    lap_.tv_sec = lap_.tv_usec = 0;
+}
+
+void FlushTimer::Start() {
+    if(!enabled_)
+        return;
+    memset(us_, 0, sizeof(us_));
+    gettimeofday(&lap_, NULL);
+}
+
+void FlushTimer::Lap(int stage) {
+    if(!enabled_)
+        return;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    us_[stage] += (uint64_t)(now.tv_sec - lap_.tv_sec) * 1000000 +
+        now.tv_usec - lap_.tv_usec;
+    lap_ = now;
+}
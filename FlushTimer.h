@@ -0,0 +1,56 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FLUSH_TIMER_H__
+#define __FLUSH_TIMER_H__
+
+#include <stdint.h>
+#include <sys/time.h>
+
+#define FLUSH_TIMER_STAGES 8
+
+namespace LCD {
+
+/*
+ * Wall time one flush of a display spends in each of its stages, in us.
+ * Start begins a flush and Lap charges the time since the previous call
+ * to a stage. Both do nothing until the timer is enabled, so displays
+ * leave the calls in place and only drivers that report on themselves
+ * pay for the clock reads.
+ */
+class FlushTimer {
+
+    bool enabled_;
+    uint64_t us_[FLUSH_TIMER_STAGES];
+    struct timeval lap_;
+
+    public:
+    FlushTimer();
+    void Enable(bool enabled) { enabled_ = enabled; }
+    bool Enabled() { return enabled_; }
+    void Start();
+    void Lap(int stage);
+    uint64_t Time(int stage) { return us_[stage]; }
+};
+
+}; // End namespace
+
+#endif
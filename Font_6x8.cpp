@@ -23,7 +23,7 @@
 
 #include "Font_6x8.h"
 
-int Font_6x8[256][8] = {
+const uint8_t Font_6x8[256][8] = {
     /*0x0*/  {______,
               ______,
               ______,
@@ -24,6 +24,8 @@
 #ifndef __FONT_6X8_H__
 #define __FONT_6X8_H__
 
+#include <stdint.h>
+
 #define ______ 0x0
 #define _____O 0x1
 #define ____O_ 0x2
@@ -89,4 +91,8 @@
 #define OOOOO_ 0x3e
 #define OOOOOO 0x3f
 
+// One byte per glyph row, leftmost pixel in bit 5.
+extern const uint8_t Font_6x8[256][8];
+extern const uint8_t Font_6x8_bold[256][8];
+
 #endif
@@ -0,0 +1,356 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <map>
+
+#include "GifRecorder.h"
+#include "debug.h"
+
+using namespace LCD;
+
+#define HASH_SIZE 5003
+#define CODE_MAX 4096
+
+GifRecorder::GifRecorder(std::string file, int scale_x, int scale_y) {
+    file_ = file;
+    scale_x_ = scale_x < 1 ? 1 : scale_x;
+    scale_y_ = scale_y < 1 ? 1 : scale_y;
+    rows_ = 0;
+    cols_ = 0;
+    started_ = false;
+    stopping_ = false;
+    bits_ = 0;
+    nbits_ = 0;
+    out_ = fopen(file.c_str(), "wb");
+    if(!out_)
+        LCDError("GifRecorder: Unable to open %s", file.c_str());
+}
+
+GifRecorder::~GifRecorder() {
+    Stop();
+}
+
+// Keep the frame if it differs from the last one, as the rectangle that
+// changed. A GIF has one screen size, so a resize ends the recording.
+void GifRecorder::Capture(const uint32_t *xrgb, int rows, int cols,
+    int stride) {
+    if(!out_ || rows <= 0 || cols <= 0)
+        return;
+
+    bool first = !started_;
+    if(first) {
+        rows_ = rows;
+        cols_ = cols;
+        last_.assign(rows * cols, 0);
+    } else if(rows != rows_ || cols != cols_) {
+        LCDError("GifRecorder: Display resized from %dx%d to %dx%d, "
+            "stopping %s", cols_, rows_, cols, rows, file_.c_str());
+        Stop();
+        return;
+    }
+
+    int top = rows, bottom = -1, left = cols, right = -1;
+    for(int r = 0; r < rows; r++) {
+        const uint32_t *src = (const uint32_t *)((const uint8_t *)xrgb +
+            r * stride);
+        uint32_t *prev = &last_[r * cols];
+        if(!first && !memcmp(src, prev, cols * sizeof(uint32_t)))
+            continue;
+        int c0 = 0, c1 = cols - 1;
+        if(!first) {
+            while(src[c0] == prev[c0])
+                c0++;
+            while(src[c1] == prev[c1])
+                c1--;
+        }
+        if(r < top)
+            top = r;
+        bottom = r;
+        if(c0 < left)
+            left = c0;
+        if(c1 > right)
+            right = c1;
+        memcpy(prev, src, cols * sizeof(uint32_t));
+    }
+    if(bottom < 0)
+        return;
+    started_ = true;
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    mutex_.lock();
+    if(queue_.size() >= GIF_QUEUE_MAX) {
+        // Fold into the last queued rectangle; it keeps its start time.
+        Shot &back = queue_.back();
+        int r1 = back.row + back.height > bottom + 1 ?
+            back.row + back.height : bottom + 1;
+        int c1 = back.col + back.width > right + 1 ?
+            back.col + back.width : right + 1;
+        back.row = back.row < top ? back.row : top;
+        back.col = back.col < left ? back.col : left;
+        back.height = r1 - back.row;
+        back.width = c1 - back.col;
+        Extract(back);
+    } else {
+        queue_.push_back(Shot());
+        Shot &shot = queue_.back();
+        shot.row = top;
+        shot.col = left;
+        shot.height = bottom - top + 1;
+        shot.width = right - left + 1;
+        shot.time = now;
+        Extract(shot);
+    }
+    ready_.wakeOne();
+    mutex_.unlock();
+}
+
+// Copy the shot's rectangle out of the last frame.
+void GifRecorder::Extract(Shot &shot) {
+    shot.pixels.resize(shot.height * shot.width);
+    for(int r = 0; r < shot.height; r++)
+        memcpy(&shot.pixels[r * shot.width],
+            &last_[(shot.row + r) * cols_ + shot.col],
+            shot.width * sizeof(uint32_t));
+}
+
+// Write out what is queued, end the file and wait for the encoder.
+void GifRecorder::Stop() {
+    mutex_.lock();
+    if(!stopping_)
+        gettimeofday(&stop_time_, NULL);
+    stopping_ = true;
+    ready_.wakeOne();
+    mutex_.unlock();
+    wait();
+    if(out_) {
+        fclose(out_);
+        out_ = NULL;
+    }
+}
+
+static int Delay(const struct timeval &from, const struct timeval &to) {
+    long ms = (to.tv_sec - from.tv_sec) * 1000 +
+        (to.tv_usec - from.tv_usec) / 1000;
+    long cs = (ms + 5) / 10;
+    if(cs < 2)
+        cs = 2;
+    if(cs > 65535)
+        cs = 65535;
+    return cs;
+}
+
+void GifRecorder::run() {
+    Shot pending;
+    bool have_pending = false;
+
+    for(;;) {
+        mutex_.lock();
+        while(queue_.empty() && !stopping_)
+            ready_.wait(&mutex_);
+        if(queue_.empty()) {
+            mutex_.unlock();
+            break;
+        }
+        Shot shot;
+        shot.pixels.swap(queue_.front().pixels);
+        shot.row = queue_.front().row;
+        shot.col = queue_.front().col;
+        shot.height = queue_.front().height;
+        shot.width = queue_.front().width;
+        shot.time = queue_.front().time;
+        queue_.pop_front();
+        mutex_.unlock();
+
+        if(!out_)
+            continue;
+        if(have_pending)
+            WriteFrame(pending, Delay(pending.time, shot.time));
+        else
+            WriteHeader();
+        pending.pixels.swap(shot.pixels);
+        pending.row = shot.row;
+        pending.col = shot.col;
+        pending.height = shot.height;
+        pending.width = shot.width;
+        pending.time = shot.time;
+        have_pending = true;
+    }
+
+    if(!out_ || !have_pending)
+        return;
+    WriteFrame(pending, Delay(pending.time, stop_time_));
+    fputc(0x3b, out_);
+}
+
+static void Put16(FILE *out, int v) {
+    fputc(v & 0xff, out);
+    fputc((v >> 8) & 0xff, out);
+}
+
+// Screen descriptor without a global table, and loop forever.
+void GifRecorder::WriteHeader() {
+    fwrite("GIF89a", 1, 6, out_);
+    Put16(out_, cols_ * scale_x_);
+    Put16(out_, rows_ * scale_y_);
+    fputc(0, out_);
+    fputc(0, out_);
+    fputc(0, out_);
+    fwrite("\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00", 1, 19, out_);
+}
+
+// One image with its own color table: exact when the rectangle has 256
+// colors or fewer, 3-3-2 RGB otherwise.
+void GifRecorder::WriteFrame(const Shot &shot, int delay) {
+    std::map<uint32_t, int> colors;
+    std::vector<uint32_t> palette;
+    int npixels = shot.height * shot.width;
+    bool exact = true;
+
+    for(int n = 0; n < npixels; n++) {
+        uint32_t c = shot.pixels[n] & 0xffffff;
+        if(colors.count(c))
+            continue;
+        if(palette.size() == 256) {
+            exact = false;
+            break;
+        }
+        colors[c] = palette.size();
+        palette.push_back(c);
+    }
+    if(!exact) {
+        palette.resize(256);
+        for(int i = 0; i < 256; i++)
+            palette[i] = (((i >> 5) & 7) * 255 / 7) << 16 |
+                (((i >> 2) & 7) * 255 / 7) << 8 | (i & 3) * 255 / 3;
+    }
+
+    int table_bits = 1;
+    while((1 << table_bits) < (int)palette.size())
+        table_bits++;
+
+    // Scaled index stream, one row built and repeated scale_y_ times.
+    int width = shot.width * scale_x_;
+    index_.resize(npixels * scale_x_ * scale_y_);
+    uint8_t *out = &index_[0];
+    for(int r = 0; r < shot.height; r++) {
+        const uint32_t *src = &shot.pixels[r * shot.width];
+        for(int c = 0; c < shot.width; c++) {
+            uint32_t p = src[c] & 0xffffff;
+            uint8_t i = exact ? colors[p] :
+                (((p >> 16) & 0xff) * 7 + 127) / 255 << 5 |
+                (((p >> 8) & 0xff) * 7 + 127) / 255 << 2 |
+                ((p & 0xff) * 3 + 127) / 255;
+            for(int x = 0; x < scale_x_; x++)
+                *out++ = i;
+        }
+        for(int y = 1; y < scale_y_; y++, out += width)
+            memcpy(out, out - width, width);
+    }
+
+    // Graphic control: leave in place, delay in hundredths.
+    fwrite("\x21\xf9\x04\x04", 1, 4, out_);
+    Put16(out_, delay);
+    fputc(0, out_);
+    fputc(0, out_);
+
+    fputc(0x2c, out_);
+    Put16(out_, shot.col * scale_x_);
+    Put16(out_, shot.row * scale_y_);
+    Put16(out_, width);
+    Put16(out_, shot.height * scale_y_);
+    fputc(0x80 | (table_bits - 1), out_);
+    for(int i = 0; i < (1 << table_bits); i++) {
+        uint32_t c = i < (int)palette.size() ? palette[i] : 0;
+        fputc((c >> 16) & 0xff, out_);
+        fputc((c >> 8) & 0xff, out_);
+        fputc(c & 0xff, out_);
+    }
+
+    Encode(table_bits < 2 ? 2 : table_bits);
+}
+
+void GifRecorder::WriteCode(int code, int size) {
+    bits_ |= code << nbits_;
+    nbits_ += size;
+    while(nbits_ >= 8) {
+        block_.push_back(bits_ & 0xff);
+        bits_ >>= 8;
+        nbits_ -= 8;
+        if(block_.size() == 255)
+            FlushBlock();
+    }
+}
+
+void GifRecorder::FlushBlock() {
+    if(block_.empty())
+        return;
+    fputc(block_.size(), out_);
+    fwrite(&block_[0], 1, block_.size(), out_);
+    block_.clear();
+}
+
+// LZW compress index_ into data sub-blocks.
+void GifRecorder::Encode(int min_size) {
+    int clear = 1 << min_size, end = clear + 1;
+    int next = end + 1, size = min_size + 1;
+    std::vector<int> key(HASH_SIZE, -1), code(HASH_SIZE);
+
+    fputc(min_size, out_);
+    bits_ = 0;
+    nbits_ = 0;
+    block_.clear();
+    WriteCode(clear, size);
+
+    int prefix = index_[0];
+    for(unsigned int n = 1; n < index_.size(); n++) {
+        int c = index_[n];
+        int k = (prefix << 8) | c;
+        int h = k % HASH_SIZE;
+        while(key[h] != -1 && key[h] != k)
+            h = (h + 1) % HASH_SIZE;
+        if(key[h] == k) {
+            prefix = code[h];
+            continue;
+        }
+        WriteCode(prefix, size);
+        if(next < CODE_MAX) {
+            key[h] = k;
+            code[h] = next++;
+            if(next > (1 << size) && size < 12)
+                size++;
+        } else {
+            WriteCode(clear, size);
+            key.assign(HASH_SIZE, -1);
+            next = end + 1;
+            size = min_size + 1;
+        }
+        prefix = c;
+    }
+    WriteCode(prefix, size);
+    WriteCode(end, size);
+    if(nbits_ > 0)
+        block_.push_back(bits_ & 0xff);
+    FlushBlock();
+    fputc(0, out_);
+}
@@ -0,0 +1,101 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIF_RECORDER_H__
+#define __GIF_RECORDER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+#define GIF_QUEUE_MAX 8
+
+namespace LCD {
+
+/*
+ * Records an animated GIF while the display runs. Capture compares a
+ * frame with the last one it kept and queues only the rectangle that
+ * changed, skipping identical frames outright; a background thread
+ * encodes queued rectangles into the file as they arrive. A frame's
+ * delay is the time until the next change, so each one is written when
+ * its successor shows up. At most GIF_QUEUE_MAX rectangles wait; past
+ * that the newest is merged into the last queued one, so memory stays
+ * bounded however long the capture runs. A GIF can't change size, so
+ * a frame of another size stops the recorder and ends the file there.
+ */
+class GifRecorder : public QThread {
+
+    typedef struct _Shot {
+        int row;
+        int col;
+        int height;
+        int width;
+        std::vector<uint32_t> pixels;
+        struct timeval time;
+    } Shot;
+
+    std::string file_;
+    FILE *out_;
+    int scale_x_;
+    int scale_y_;
+    int rows_;
+    int cols_;
+    std::vector<uint32_t> last_;
+    bool started_;
+
+    QMutex mutex_;
+    QWaitCondition ready_;
+    std::deque<Shot> queue_;
+    bool stopping_;
+    struct timeval stop_time_;
+
+    // Encoder thread only.
+    std::vector<uint8_t> index_;
+    std::vector<uint8_t> block_;
+    uint32_t bits_;
+    int nbits_;
+
+    void Extract(Shot &shot);
+    void WriteHeader();
+    void WriteFrame(const Shot &shot, int delay);
+    void WriteCode(int code, int size);
+    void FlushBlock();
+    void Encode(int min_size);
+
+    protected:
+    void run();
+
+    public:
+    GifRecorder(std::string file, int scale_x, int scale_y);
+    ~GifRecorder();
+    void Capture(const uint32_t *xrgb, int rows, int cols, int stride);
+    void Stop();
+};
+
+}; // End namespace
+
+#endif
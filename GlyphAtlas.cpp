@@ -0,0 +1,83 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "GlyphAtlas.h"
+#include "Font_6x8.h"
+
+using namespace LCD;
+
+GlyphAtlas::GlyphAtlas() {
+    xres_ = 0;
+    yres_ = 0;
+    clock_ = 0;
+}
+
+void GlyphAtlas::Resize(int xres, int yres) {
+    if(xres == xres_ && yres == yres_)
+        return;
+    xres_ = xres;
+    yres_ = yres;
+    atlases_.clear();
+}
+
+const RGBA *GlyphAtlas::Glyph(bool bold, RGBA fg, RGBA bg, unsigned char ch) {
+    uint32_t f, b;
+    memcpy(&f, &fg, sizeof(f));
+    memcpy(&b, &bg, sizeof(b));
+    Key key(bold, ((uint64_t)f << 32) | b);
+    int size = xres_ * yres_;
+
+    std::map<Key, Atlas>::iterator it = atlases_.find(key);
+    if(it == atlases_.end()) {
+        if(atlases_.size() >= ATLAS_MAX) {
+            std::map<Key, Atlas>::iterator oldest = atlases_.begin();
+            for(std::map<Key, Atlas>::iterator i = atlases_.begin();
+                i != atlases_.end(); i++) {
+                if(i->second.used < oldest->second.used)
+                    oldest = i;
+            }
+            atlases_.erase(oldest);
+        }
+        it = atlases_.insert(std::make_pair(key, Atlas())).first;
+        it->second.pixels.resize(256 * size);
+        it->second.ready.assign(256, false);
+    }
+
+    Atlas &atlas = it->second;
+    atlas.used = ++clock_;
+    RGBA *glyph = &atlas.pixels[ch * size];
+
+    if(!atlas.ready[ch]) {
+        const uint8_t *rows = bold ? Font_6x8_bold[ch] : Font_6x8[ch];
+        for(int y = 0; y < yres_; y++) {
+            int bits = y < 8 ? rows[y] : 0;
+            for(int x = 0; x < xres_; x++) {
+                int shift = xres_ - 1 - x;
+                glyph[y * xres_ + x] =
+                    shift < 8 && (bits >> shift) & 1 ? fg : bg;
+            }
+        }
+        atlas.ready[ch] = true;
+    }
+    return glyph;
+}
@@ -0,0 +1,68 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GLYPH_ATLAS_H__
+#define __GLYPH_ATLAS_H__
+
+#include <map>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+#include "RGBA.h"
+
+#define ATLAS_MAX 16
+
+namespace LCD {
+
+/*
+ * Font_6x8 glyphs expanded to RGBA, one atlas per (bold, fg, bg). A
+ * glyph is expanded the first time it is asked for, as xres columns by
+ * yres rows laid out row after row, so text rendering becomes a memcpy
+ * per glyph row. Columns are taken right-aligned from the font bits and
+ * rows past the font's eight are background, as GraphicRender drew
+ * them. At most ATLAS_MAX colour pairs are kept, least recently used
+ * dropped first.
+ */
+class GlyphAtlas {
+
+    typedef std::pair<int, uint64_t> Key;
+
+    typedef struct _Atlas {
+        std::vector<RGBA> pixels;
+        std::vector<bool> ready;
+        unsigned long used;
+    } Atlas;
+
+    int xres_;
+    int yres_;
+    unsigned long clock_;
+    std::map<Key, Atlas> atlases_;
+
+    public:
+    GlyphAtlas();
+    void Resize(int xres, int yres);
+    const RGBA *Glyph(bool bold, RGBA fg, RGBA bg, unsigned char ch);
+};
+
+}; // End namespace
+
+#endif
@@ -0,0 +1,160 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "GraphicComposite.h"
+
+using namespace LCD;
+
+/* x / 255 rounded down, exact for x <= 255 * 255 */
+#define DIV255(x) (((x) + 1 + ((x) >> 8)) >> 8)
+
+#if defined(__AVX2__)
+static inline __m256i Over256(__m256i ret, __m256i p) {
+    const __m256i full = _mm256_set1_epi16(255);
+    const __m256i one = _mm256_set1_epi16(1);
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(p, 0xff), 0xff);
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(p, a),
+        _mm256_mullo_epi16(ret, _mm256_sub_epi16(full, a)));
+    t = _mm256_add_epi16(_mm256_add_epi16(t, one), _mm256_srli_epi16(t, 8));
+    return _mm256_srli_epi16(t, 8);
+}
+#endif
+
+#if defined(__SSE2__)
+static inline __m128i Over128(__m128i ret, __m128i p) {
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, 0xff), 0xff);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(p, a),
+        _mm_mullo_epi16(ret, _mm_sub_epi16(full, a)));
+    t = _mm_add_epi16(_mm_add_epi16(t, one), _mm_srli_epi16(t, 8));
+    return _mm_srli_epi16(t, 8);
+}
+#endif
+
+// Lay the layers over under[0, len) if given, over base otherwise.
+static void Composite(RGBA *dst, RGBA **layers, int nlayers,
+    int pos, int len, RGBA base, const RGBA *under, bool inverted) {
+    uint32_t base32;
+    int n = 0;
+
+    memcpy(&base32, &base, sizeof(base32));
+
+#if defined(__AVX2__)
+    const __m256i zero32 = _mm256_setzero_si256();
+    const __m256i alpha32 = _mm256_set1_epi32((int)0xff000000);
+    const __m256i color32 = _mm256_set1_epi32(0x00ffffff);
+    const __m256i base256 = _mm256_unpacklo_epi8(
+        _mm256_set1_epi32((int)base32), zero32);
+    for(; n + 8 <= len; n += 8) {
+        __m256i lo = base256, hi = base256, any = zero32;
+        if(under) {
+            any = _mm256_loadu_si256((const __m256i *)(under + n));
+            lo = _mm256_unpacklo_epi8(any, zero32);
+            hi = _mm256_unpackhi_epi8(any, zero32);
+        }
+        for(int l = nlayers - 1; l >= 0; l--) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(layers[l] + pos + n));
+            any = _mm256_or_si256(any, v);
+            lo = Over256(lo, _mm256_unpacklo_epi8(v, zero32));
+            hi = Over256(hi, _mm256_unpackhi_epi8(v, zero32));
+        }
+        __m256i bare = _mm256_cmpeq_epi32(_mm256_and_si256(any, alpha32), zero32);
+        __m256i out = _mm256_or_si256(
+            _mm256_and_si256(_mm256_packus_epi16(lo, hi), color32),
+            _mm256_andnot_si256(bare, alpha32));
+        if(inverted)
+            out = _mm256_xor_si256(out, color32);
+        _mm256_storeu_si256((__m256i *)(dst + n), out);
+    }
+#endif
+
+#if defined(__SSE2__)
+    const __m128i zero16 = _mm_setzero_si128();
+    const __m128i alpha16 = _mm_set1_epi32((int)0xff000000);
+    const __m128i color16 = _mm_set1_epi32(0x00ffffff);
+    const __m128i base128 = _mm_unpacklo_epi8(
+        _mm_set1_epi32((int)base32), zero16);
+    for(; n + 4 <= len; n += 4) {
+        __m128i lo = base128, hi = base128, any = zero16;
+        if(under) {
+            any = _mm_loadu_si128((const __m128i *)(under + n));
+            lo = _mm_unpacklo_epi8(any, zero16);
+            hi = _mm_unpackhi_epi8(any, zero16);
+        }
+        for(int l = nlayers - 1; l >= 0; l--) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(layers[l] + pos + n));
+            any = _mm_or_si128(any, v);
+            lo = Over128(lo, _mm_unpacklo_epi8(v, zero16));
+            hi = Over128(hi, _mm_unpackhi_epi8(v, zero16));
+        }
+        __m128i bare = _mm_cmpeq_epi32(_mm_and_si128(any, alpha16), zero16);
+        __m128i out = _mm_or_si128(
+            _mm_and_si128(_mm_packus_epi16(lo, hi), color16),
+            _mm_andnot_si128(bare, alpha16));
+        if(inverted)
+            out = _mm_xor_si128(out, color16);
+        _mm_storeu_si128((__m128i *)(dst + n), out);
+    }
+#endif
+
+    for(; n < len; n++) {
+        RGBA ret = base;
+        ret.A = 0x00;
+        if(under)
+            ret = under[n];
+        for(int l = nlayers - 1; l >= 0; l--) {
+            RGBA p = layers[l][pos + n];
+            if(p.A == 0)
+                continue;
+            ret.R = DIV255(p.R * p.A + ret.R * (255 - p.A));
+            ret.G = DIV255(p.G * p.A + ret.G * (255 - p.A));
+            ret.B = DIV255(p.B * p.A + ret.B * (255 - p.A));
+            ret.A = 0xff;
+        }
+        if(inverted) {
+            ret.R = 255 - ret.R;
+            ret.G = 255 - ret.G;
+            ret.B = 255 - ret.B;
+        }
+        dst[n] = ret;
+    }
+}
+
+void LCD::GraphicComposite(RGBA *dst, RGBA **layers, int nlayers,
+    int pos, int len, RGBA base, bool inverted) {
+    Composite(dst, layers, nlayers, pos, len, base, NULL, inverted);
+}
+
+void LCD::GraphicCompositeOver(RGBA *dst, RGBA **layers, int nlayers,
+    int pos, int len, const RGBA *under, bool inverted) {
+    RGBA base(0, 0, 0, 0);
+    Composite(dst, layers, nlayers, pos, len, base, under, inverted);
+}
@@ -0,0 +1,191 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "GraphicDamage.h"
+
+using namespace LCD;
+
+GraphicDamage::GraphicDamage() {
+    tiles_ = 0;
+    skipped_ = 0;
+    Resize(0, 0);
+}
+
+void GraphicDamage::Resize(int rows, int cols) {
+    rows_ = rows;
+    cols_ = cols;
+    tile_rows_ = (rows + TILE_SIZE - 1) / TILE_SIZE;
+    tile_cols_ = (cols + TILE_SIZE - 1) / TILE_SIZE;
+    words_ = (tile_cols_ + 63) / 64;
+    dirty_.assign(tile_rows_ * words_, 0);
+    hash_.assign(tile_rows_ * tile_cols_, 0);
+    known_.assign(tile_rows_ * tile_cols_, false);
+}
+
+void GraphicDamage::Mark(int row, int col, int height, int width) {
+    if(row < 0) {
+        height += row;
+        row = 0;
+    }
+    if(col < 0) {
+        width += col;
+        col = 0;
+    }
+    if(row + height > rows_)
+        height = rows_ - row;
+    if(col + width > cols_)
+        width = cols_ - col;
+    if(height <= 0 || width <= 0)
+        return;
+
+    int last_row = (row + height - 1) / TILE_SIZE;
+    int last_col = (col + width - 1) / TILE_SIZE;
+    for(int r = row / TILE_SIZE; r <= last_row; r++) {
+        uint64_t *bits = &dirty_[r * words_];
+        for(int c = col / TILE_SIZE; c <= last_col; c++)
+            bits[c / 64] |= (uint64_t)1 << (c % 64);
+    }
+}
+
+// Add tiles [first, last] of a tile row as one rectangle, clipped to the
+// display, growing the rectangle above it when the columns match.
+void GraphicDamage::Append(std::vector<GraphicRect> &rects, int trow,
+    int first, int last) {
+    GraphicRect rect;
+    rect.row = trow * TILE_SIZE;
+    rect.col = first * TILE_SIZE;
+    rect.height = TILE_SIZE;
+    rect.width = (last + 1) * TILE_SIZE;
+    if(rect.row + rect.height > rows_)
+        rect.height = rows_ - rect.row;
+    if(rect.width > cols_)
+        rect.width = cols_;
+    rect.width -= rect.col;
+    rect.data = NULL;
+    rect.stride = 0;
+
+    for(int i = rects.size() - 1; i >= 0; i--) {
+        GraphicRect &above = rects[i];
+        if(above.row + above.height < rect.row)
+            break;
+        if(above.row + above.height == rect.row &&
+            above.col == rect.col && above.width == rect.width) {
+            above.height += rect.height;
+            return;
+        }
+    }
+    rects.push_back(rect);
+}
+
+bool GraphicDamage::Take(std::vector<GraphicRect> &rects) {
+    rects.clear();
+    for(int r = 0; r < tile_rows_; r++) {
+        uint64_t *bits = &dirty_[r * words_];
+        int first = -1;
+        for(int c = 0; c <= tile_cols_; c++) {
+            bool set = c < tile_cols_ &&
+                (bits[c / 64] >> (c % 64)) & 1;
+            if(set && first < 0) {
+                first = c;
+            } else if(!set && first >= 0) {
+                Append(rects, r, first, c - 1);
+                first = -1;
+            }
+        }
+        memset(bits, 0, words_ * sizeof(uint64_t));
+    }
+    return !rects.empty();
+}
+
+// FNV-1a over the tile's pixels.
+uint64_t GraphicDamage::TileHash(const RGBA *fb, int trow, int tcol) {
+    uint64_t hash = 14695981039346656037ULL;
+    int row = trow * TILE_SIZE;
+    int col = tcol * TILE_SIZE;
+    int height = rows_ - row < TILE_SIZE ? rows_ - row : TILE_SIZE;
+    int width = cols_ - col < TILE_SIZE ? cols_ - col : TILE_SIZE;
+
+    for(int r = row; r < row + height; r++) {
+        const uint32_t *px = (const uint32_t *)(fb + r * cols_ + col);
+        for(int c = 0; c < width; c++) {
+            hash ^= px[c];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+void GraphicDamage::Changed(const RGBA *fb, const std::vector<GraphicRect> &in,
+    std::vector<GraphicRect> &out) {
+    out.clear();
+    for(unsigned int i = 0; i < in.size(); i++) {
+        int first_row = in[i].row / TILE_SIZE;
+        int last_row = (in[i].row + in[i].height - 1) / TILE_SIZE;
+        int first_col = in[i].col / TILE_SIZE;
+        int last_col = (in[i].col + in[i].width - 1) / TILE_SIZE;
+
+        for(int r = first_row; r <= last_row; r++) {
+            int first = -1;
+            for(int c = first_col; c <= last_col + 1; c++) {
+                bool changed = false;
+                if(c <= last_col) {
+                    int n = r * tile_cols_ + c;
+                    uint64_t hash = TileHash(fb, r, c);
+                    tiles_++;
+                    changed = !known_[n] || hash_[n] != hash;
+                    if(changed) {
+                        hash_[n] = hash;
+                        known_[n] = true;
+                    } else {
+                        skipped_++;
+                    }
+                }
+                if(changed && first < 0) {
+                    first = c;
+                } else if(!changed && first >= 0) {
+                    Append(out, r, first, c - 1);
+                    first = -1;
+                }
+            }
+        }
+    }
+}
+
+// Record fb as sent for every tile overlapping the window.
+void GraphicDamage::Store(const RGBA *fb, int row, int col, int height,
+    int width) {
+    if(height <= 0 || width <= 0)
+        return;
+    int last_row = (row + height - 1) / TILE_SIZE;
+    int last_col = (col + width - 1) / TILE_SIZE;
+    for(int r = row / TILE_SIZE; r <= last_row && r < tile_rows_; r++) {
+        for(int c = col / TILE_SIZE; c <= last_col && c < tile_cols_; c++) {
+            hash_[r * tile_cols_ + c] = TileHash(fb, r, c);
+            known_[r * tile_cols_ + c] = true;
+        }
+    }
+}
+
+void GraphicDamage::Invalidate() {
+    known_.assign(known_.size(), false);
+}
@@ -0,0 +1,84 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GRAPHIC_DAMAGE_H__
+#define __GRAPHIC_DAMAGE_H__
+
+#include <vector>
+#include <stdint.h>
+
+#include "RGBA.h"
+
+#define TILE_SIZE 8
+
+namespace LCD {
+
+// A window of pixels to send to the device, packed at data.
+typedef struct _GraphicRect {
+    int row;
+    int col;
+    int height;
+    int width;
+    const uint8_t *data;
+    int stride;
+} GraphicRect;
+
+/*
+ * Damage tracking for graphic displays on a grid of TILE_SIZE square
+ * tiles. Draws mark the tiles they touch; Take hands the marked tiles
+ * back as rectangles and clears them. Each tile also remembers a hash
+ * of what the device was last sent, so Changed can drop tiles that were
+ * redrawn with the same pixels and join the rest into as few
+ * rectangles as it can. Rectangles come back with data left NULL.
+ */
+class GraphicDamage {
+
+    int rows_;
+    int cols_;
+    int tile_rows_;
+    int tile_cols_;
+    int words_;
+    std::vector<uint64_t> dirty_;
+    std::vector<uint64_t> hash_;
+    std::vector<bool> known_;
+    unsigned long tiles_;
+    unsigned long skipped_;
+
+    uint64_t TileHash(const RGBA *fb, int trow, int tcol);
+    void Append(std::vector<GraphicRect> &rects, int trow, int first,
+        int last);
+
+    public:
+    GraphicDamage();
+    void Resize(int rows, int cols);
+    void Mark(int row, int col, int height, int width);
+    bool Take(std::vector<GraphicRect> &rects);
+    void Changed(const RGBA *fb, const std::vector<GraphicRect> &in,
+        std::vector<GraphicRect> &out);
+    void Store(const RGBA *fb, int row, int col, int height, int width);
+    void Invalidate();
+    unsigned long Tiles() { return tiles_; }
+    unsigned long Skipped() { return skipped_; }
+};
+
+}; // End namespace
+
+#endif
@@ -0,0 +1,124 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "GraphicDither.h"
+
+using namespace LCD;
+
+/* x / 255 rounded down, exact for x <= 255 * 255 */
+#define DIV255(x) (((x) + 1 + ((x) >> 8)) >> 8)
+
+static const uint8_t Bayer[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+GraphicDither::GraphicDither() {
+    mode_ = DITHER_NONE;
+}
+
+// A new window begins; forget the error carried so far.
+void GraphicDither::Start(int width) {
+    if(mode_ != DITHER_DIFFUSION)
+        return;
+    error_.assign(width + 2, 0);
+    next_.assign(width + 2, 0);
+}
+
+void GraphicDither::Row(uint8_t *gray, int width, int row, int col,
+    int levels) {
+    if(mode_ == DITHER_ORDERED)
+        Ordered(gray, width, row, col, levels);
+    else if(mode_ == DITHER_DIFFUSION)
+        Diffuse(gray, width, levels);
+}
+
+// Level = floor(g * (levels - 1) / 255), plus one where the remainder
+// beats the matrix's threshold for this pixel.
+void GraphicDither::Ordered(uint8_t *gray, int width, int row, int col,
+    int levels) {
+    int16_t threshold[16];
+    for(int i = 0; i < 16; i++)
+        threshold[i] = (Bayer[row & 7][(col + i) & 7] * 2 + 1) * 255 / 128;
+    int scale = levels - 1;
+    int step = 255 / scale;
+    int n = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i scale16 = _mm_set1_epi16(scale);
+    const __m128i step16 = _mm_set1_epi16(step);
+    const __m128i limit = _mm_loadu_si128((const __m128i *)threshold);
+    for(; n + 8 <= width; n += 8) {
+        __m128i g = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i *)(gray + n)), zero);
+        __m128i s = _mm_mullo_epi16(g, scale16);
+        __m128i base = _mm_srli_epi16(
+            _mm_add_epi16(_mm_add_epi16(s, one), _mm_srli_epi16(s, 8)), 8);
+        __m128i frac = _mm_sub_epi16(s, _mm_mullo_epi16(base, full));
+        __m128i up = _mm_and_si128(_mm_cmpgt_epi16(frac, limit), one);
+        __m128i out = _mm_mullo_epi16(_mm_add_epi16(base, up), step16);
+        _mm_storel_epi64((__m128i *)(gray + n), _mm_packus_epi16(out, zero));
+    }
+#endif
+
+    for(; n < width; n++) {
+        int s = gray[n] * scale;
+        int base = DIV255(s);
+        int level = base + (s - base * 255 > threshold[n & 7]);
+        gray[n] = level * step;
+    }
+}
+
+// Floyd-Steinberg, left to right.
+void GraphicDither::Diffuse(uint8_t *gray, int width, int levels) {
+    if(width + 2 > (int)error_.size())
+        Start(width);
+    int scale = levels - 1;
+    int step = 255 / scale;
+    for(int n = 0; n < width; n++) {
+        int v = gray[n] + error_[n + 1] / 16;
+        int c = v < 0 ? 0 : v > 255 ? 255 : v;
+        int out = (c * scale + 127) / 255 * step;
+        int e = v - out;
+        error_[n + 2] += e * 7;
+        next_[n] += e * 3;
+        next_[n + 1] += e * 5;
+        next_[n + 2] += e;
+        gray[n] = out;
+    }
+    error_.swap(next_);
+    memset(&next_[0], 0, next_.size() * sizeof(int));
+}
@@ -0,0 +1,61 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GRAPHIC_DITHER_H__
+#define __GRAPHIC_DITHER_H__
+
+#include <vector>
+#include <stdint.h>
+
+#define DITHER_NONE 0          // hard threshold at mid gray
+#define DITHER_ORDERED 1       // 8x8 Bayer matrix
+#define DITHER_DIFFUSION 2     // Floyd-Steinberg
+
+namespace LCD {
+
+/*
+ * Reduce rows of gray levels to the levels a panel can show, in place,
+ * each becoming the gray the packer maps back to that level exactly.
+ * Ordered dithering depends only on a pixel's place on the device, so
+ * windows dithered on their own tile seamlessly; it works 8 pixels at
+ * a time with SSE2. Error diffusion carries error from row to row of
+ * one window, so it is only seamless when the window is the frame.
+ */
+class GraphicDither {
+
+    int mode_;
+    std::vector<int> error_;
+    std::vector<int> next_;
+
+    void Ordered(uint8_t *gray, int width, int row, int col, int levels);
+    void Diffuse(uint8_t *gray, int width, int levels);
+
+    public:
+    GraphicDither();
+    void Setup(int mode) { mode_ = mode; }
+    int Mode() { return mode_; }
+    void Start(int width);
+    void Row(uint8_t *gray, int width, int row, int col, int levels);
+};
+
+}; // End namespace
+
+#endif
@@ -0,0 +1,151 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+
+#include "GraphicFrames.h"
+#include "GraphicPack.h"
+
+using namespace LCD;
+
+#define FRESH 4
+#define MAX_RECTS 64
+
+GraphicFrames::GraphicFrames() : state_(1) {
+    front_ = 0;
+    back_ = 2;
+    rows_ = 0;
+    cols_ = 0;
+    format_ = GRAPHIC_XRGB8888;
+    generation_ = 0;
+    sequence_ = 0;
+    for(int i = 0; i < 3; i++) {
+        frames_[i].rows = 0;
+        frames_[i].cols = 0;
+        frames_[i].format = format_;
+        frames_[i].stride = 0;
+        frames_[i].generation = 0;
+        frames_[i].sequence = 0;
+    }
+}
+
+// Append rect, falling back to the whole frame once the list is long.
+void GraphicFrames::Add(std::vector<GraphicRect> &rects, const GraphicRect &rect) {
+    if(rects.size() == 1 && rects[0].height == rows_ && rects[0].width == cols_)
+        return;
+    if(rects.size() >= MAX_RECTS) {
+        rects.clear();
+        GraphicRect all = { 0, 0, rows_, cols_, NULL, 0 };
+        rects.push_back(all);
+        return;
+    }
+    rects.push_back(rect);
+}
+
+// Writer side only.
+void GraphicFrames::Resize(int rows, int cols) {
+    rows_ = rows;
+    cols_ = cols;
+    generation_++;
+}
+
+// Writer side only.
+void GraphicFrames::Publish(int format, GraphicOutput &output,
+    const RGBA *fb, const std::vector<GraphicRect> &layout_rects) {
+    if(format != format_) {
+        format_ = format;
+        generation_++;
+    }
+
+    std::vector<GraphicRect> &rects = mapped_;
+    rects = layout_rects;
+    for(unsigned int i = 0; i < rects.size(); i++)
+        output.Map(rects[i]);
+
+    Frame &frame = frames_[back_];
+    std::vector<GraphicRect> &pending = pending_[back_];
+    GraphicRect all = { 0, 0, rows_, cols_, NULL, 0 };
+
+    if(rows_ <= 0 || cols_ <= 0)
+        return;
+
+    bool realloc = frame.generation != generation_;
+    if(realloc) {
+        frame.rows = rows_;
+        frame.cols = cols_;
+        frame.format = format_;
+        frame.stride = GraphicPackStride(format_, cols_);
+        frame.data.assign(frame.stride * GraphicPackLines(format_, rows_), 0);
+        frame.generation = generation_;
+        pending.clear();
+        pending.push_back(all);
+    }
+
+    frame.damage.clear();
+    if(realloc)
+        frame.damage.push_back(all);
+    for(unsigned int i = 0; i < rects.size(); i++) {
+        Add(pending, rects[i]);
+        Add(frame.damage, rects[i]);
+    }
+
+    for(unsigned int i = 0; i < pending.size(); i++) {
+        GraphicRect rect = pending[i];
+        GraphicPackAlign(format_, &rect.row, &rect.col, &rect.height,
+            &rect.width, rows_, cols_);
+        if(rect.height <= 0 || rect.width <= 0)
+            continue;
+        output.Pack(format_, fb, rect, &frame.data[GraphicPackOffset(format_,
+            rect.row, rect.col, frame.stride)], frame.stride);
+    }
+    pending.clear();
+
+    // The reader hasn't seen the ready frame; carry its damage over.
+    int state = state_.fetchAndAddOrdered(0);
+    if(state & FRESH) {
+        Frame &ready = frames_[state & 3];
+        if(ready.generation != generation_) {
+            frame.damage.clear();
+            frame.damage.push_back(all);
+        }
+        for(unsigned int i = 0; i < ready.damage.size(); i++)
+            Add(frame.damage, ready.damage[i]);
+    }
+    frame.sequence = ++sequence_;
+
+    int published = back_;
+    back_ = state_.fetchAndStoreOrdered(published | FRESH) & 3;
+
+    for(int i = 0; i < 3; i++) {
+        if(i == published)
+            continue;
+        for(unsigned int r = 0; r < rects.size(); r++)
+            Add(pending_[i], rects[r]);
+    }
+}
+
+// Reader side only. NULL when nothing was published since the last call.
+const GraphicFrames::Frame *GraphicFrames::Acquire() {
+    if(!(state_.fetchAndAddOrdered(0) & FRESH))
+        return NULL;
+    front_ = state_.fetchAndStoreOrdered(front_) & 3;
+    return &frames_[front_];
+}
@@ -0,0 +1,93 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GRAPHIC_FRAMES_H__
+#define __GRAPHIC_FRAMES_H__
+
+#include <vector>
+#include <stdint.h>
+#include <QAtomicInt>
+
+#include "RGBA.h"
+#include "GraphicDamage.h"
+#include "GraphicOutput.h"
+
+namespace LCD {
+
+/*
+ * Triple-buffered packed frames handed from the update thread to a
+ * driver that presents on a thread of its own. The writer fills its
+ * back frame and publishes it by swapping indices with the ready frame
+ * through one atomic; the reader swaps the ready frame for its front
+ * frame the same way, only when something new was published. Neither
+ * side waits on the other, and a frame is never written while it is
+ * being read.
+ *
+ * Frames are in device coordinates; rectangles are published in layout
+ * coordinates and mapped through the output stage.
+ *
+ * A frame's damage lists what changed since the frame the reader last
+ * took, including frames it skipped. A resize bumps the generation;
+ * each frame is reallocated at the new size the next time the writer
+ * takes it, so the reader keeps a valid frame throughout.
+ */
+class GraphicFrames {
+
+    public:
+    typedef struct _Frame {
+        std::vector<uint8_t> data;
+        int rows;
+        int cols;
+        int format;
+        int stride;
+        unsigned int generation;
+        unsigned long sequence;
+        std::vector<GraphicRect> damage;
+    } Frame;
+
+    private:
+    Frame frames_[3];
+    // Ready frame index, plus FRESH while the reader hasn't taken it.
+    QAtomicInt state_;
+    int back_;                                  // writer's
+    int front_;                                 // reader's
+    std::vector<GraphicRect> pending_[3];       // regions a frame lacks
+    std::vector<GraphicRect> mapped_;
+    int rows_;
+    int cols_;
+    int format_;
+    unsigned int generation_;
+    unsigned long sequence_;
+
+    void Add(std::vector<GraphicRect> &rects, const GraphicRect &rect);
+
+    public:
+    GraphicFrames();
+    void Resize(int rows, int cols);
+    void Publish(int format, GraphicOutput &output, const RGBA *fb,
+        const std::vector<GraphicRect> &rects);
+    const Frame *Acquire();
+    unsigned long Published() { return sequence_; }
+};
+
+}; // End namespace
+
+#endif
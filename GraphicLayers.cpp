@@ -0,0 +1,152 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GraphicLayers.h"
+#include "GraphicComposite.h"
+
+using namespace LCD;
+
+GraphicLayers::GraphicLayers() {
+    rows_ = 0;
+    cols_ = 0;
+    layers_ = 0;
+    tile_rows_ = 0;
+    tile_cols_ = 0;
+    flattened_ = 0;
+    cached_ = 0;
+}
+
+void GraphicLayers::Resize(int rows, int cols, int layers) {
+    rows_ = rows;
+    cols_ = cols;
+    layers_ = layers;
+    tile_rows_ = (rows + TILE_SIZE - 1) / TILE_SIZE;
+    tile_cols_ = (cols + TILE_SIZE - 1) / TILE_SIZE;
+    visible_.assign(tile_rows_ * tile_cols_, 0);
+    stale_.assign(tile_rows_ * tile_cols_, 0);
+    split_.assign(tile_rows_ * tile_cols_, -1);
+    base_.resize(rows * cols);
+    Invalidate();
+}
+
+// Every layer of every tile changed.
+void GraphicLayers::Invalidate() {
+    uint32_t all = layers_ >= LAYERS_MAX ? ~0u : (1u << layers_) - 1;
+    for(unsigned int t = 0; t < stale_.size(); t++) {
+        stale_[t] = all;
+        split_[t] = -1;
+    }
+}
+
+// Bit for layer if any pixel of the tile isn't fully transparent.
+uint32_t GraphicLayers::Visible(RGBA **layers, int layer, int trow, int tcol) {
+    int r1 = (trow + 1) * TILE_SIZE, c1 = (tcol + 1) * TILE_SIZE;
+    if(r1 > rows_)
+        r1 = rows_;
+    if(c1 > cols_)
+        c1 = cols_;
+    for(int r = trow * TILE_SIZE; r < r1; r++) {
+        const RGBA *p = layers[layer] + r * cols_;
+        for(int c = tcol * TILE_SIZE; c < c1; c++)
+            if(p[c].A)
+                return 1u << layer;
+    }
+    return 0;
+}
+
+// Bring a tile's base up to date and flatten the part of it inside the
+// window [row, row + height) x [col, col + width) into dst.
+void GraphicLayers::Tile(RGBA *dst, RGBA **layers, RGBA bg, bool inverted,
+    int trow, int tcol, int row, int col, int height, int width) {
+    int t = trow * tile_cols_ + tcol;
+    int r0 = trow * TILE_SIZE, c0 = tcol * TILE_SIZE;
+    int r1 = r0 + TILE_SIZE, c1 = c0 + TILE_SIZE;
+    if(r1 > rows_)
+        r1 = rows_;
+    if(c1 > cols_)
+        c1 = cols_;
+    int left = col > c0 ? col : c0;
+    int right = col + width < c1 ? col + width : c1;
+
+    // Deepest changed layer; everything below it can stay in the base.
+    uint32_t stale = stale_[t];
+    int deepest = -1;
+    for(int l = 0; l < layers_; l++) {
+        if(!(stale & (1u << l)))
+            continue;
+        visible_[t] = (visible_[t] & ~(1u << l)) | Visible(layers, l, trow, tcol);
+        deepest = l;
+    }
+    stale_[t] = 0;
+
+    RGBA *lower[LAYERS_MAX], *upper[LAYERS_MAX];
+    int nlower = 0, nupper = 0;
+    int split = split_[t];
+    bool rebuild = split < 0 || deepest >= split;
+    int from = rebuild ? layers_ : split;
+    for(int l = 0; l < from; l++) {
+        if(!(visible_[t] & (1u << l)))
+            continue;
+        if(l > deepest)
+            lower[nlower++] = layers[l];
+        else
+            upper[nupper++] = layers[l];
+    }
+
+    for(int r = r0; r < r1; r++) {
+        int pos = r * cols_ + c0;
+        if(rebuild)
+            GraphicComposite(&base_[pos], lower, nlower, pos, c1 - c0,
+                bg, false);
+        else if(nlower)
+            GraphicCompositeOver(&base_[pos], lower, nlower, pos, c1 - c0,
+                &base_[pos], false);
+        if(r < row || r >= row + height)
+            continue;
+        pos = r * cols_ + left;
+        GraphicCompositeOver(dst + pos, upper, nupper, pos, right - left,
+            &base_[pos], inverted);
+    }
+    split_[t] = deepest + 1;
+
+    flattened_ += (nlower + nupper) * (r1 - r0);
+    cached_ += (layers_ - nlower - nupper) * (r1 - r0);
+}
+
+// Flatten a window of the layers into dst, which is laid out like them.
+void GraphicLayers::Composite(RGBA *dst, RGBA **layers, RGBA bg,
+    bool inverted, int row, int col, int height, int width) {
+    if(height <= 0 || width <= 0)
+        return;
+
+    if(layers_ > LAYERS_MAX) {
+        for(int r = row; r < row + height; r++)
+            GraphicComposite(dst + r * cols_ + col, layers, layers_,
+                r * cols_ + col, width, bg, inverted);
+        return;
+    }
+
+    int tr1 = (row + height - 1) / TILE_SIZE;
+    int tc1 = (col + width - 1) / TILE_SIZE;
+    for(int tr = row / TILE_SIZE; tr <= tr1; tr++)
+        for(int tc = col / TILE_SIZE; tc <= tc1; tc++)
+            Tile(dst, layers, bg, inverted, tr, tc, row, col, height, width);
+}
@@ -0,0 +1,82 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GRAPHIC_LAYERS_H__
+#define __GRAPHIC_LAYERS_H__
+
+#include <vector>
+#include <stdint.h>
+
+#include "RGBA.h"
+#include "GraphicDamage.h"
+
+#define LAYERS_MAX 32
+
+namespace LCD {
+
+/*
+ * Per-tile layer bookkeeping for flattening DisplayFB. Each TILE_SIZE
+ * tile knows which layers have a visible pixel in it and which changed
+ * since it was last flattened, and keeps the layers below the deepest
+ * changed one flattened in a base buffer. Compositing a tile then lays
+ * only the visible layers above that split over the base, so a static
+ * background under changing text costs nothing after its first frame.
+ * The split only moves up when a deeper layer changes, and is lowered
+ * again on the way through when the layers above it stop changing.
+ * Output is identical to flattening every layer.
+ */
+class GraphicLayers {
+
+    int rows_;
+    int cols_;
+    int layers_;
+    int tile_rows_;
+    int tile_cols_;
+    std::vector<uint32_t> visible_;
+    std::vector<uint32_t> stale_;
+    std::vector<int> split_;        // base holds [split, layers); -1 if none
+    std::vector<RGBA> base_;
+    unsigned long flattened_;
+    unsigned long cached_;
+
+    uint32_t Visible(RGBA **layers, int layer, int trow, int tcol);
+    void Tile(RGBA *dst, RGBA **layers, RGBA bg, bool inverted,
+        int trow, int tcol, int row, int col, int height, int width);
+
+    public:
+    GraphicLayers();
+    void Resize(int rows, int cols, int layers);
+    void Touch(int layer, int row, int col) {
+        if(layer < LAYERS_MAX)
+            stale_[(row / TILE_SIZE) * tile_cols_ + col / TILE_SIZE] |=
+                1u << layer;
+    }
+    void Invalidate();
+    void Composite(RGBA *dst, RGBA **layers, RGBA bg, bool inverted,
+        int row, int col, int height, int width);
+    // Layer rows flattened, and layer rows the base saved.
+    unsigned long Flattened() { return flattened_; }
+    unsigned long Cached() { return cached_; }
+};
+
+}; // End namespace
+
+#endif
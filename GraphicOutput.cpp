@@ -0,0 +1,178 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#include "GraphicOutput.h"
+#include "GraphicPack.h"
+
+using namespace LCD;
+
+GraphicOutput::GraphicOutput() {
+    double gamma[3] = { 1.0, 1.0, 1.0 };
+    double brightness[3] = { 1.0, 1.0, 1.0 };
+    rows_ = 0;
+    cols_ = 0;
+    Setup(0, false, gamma, brightness, false);
+}
+
+// out = 255 * brightness * (in / 255) ^ gamma, then inverted if asked.
+void GraphicOutput::Setup(int rotate, bool mirror, const double gamma[3],
+    const double brightness[3], bool inverted, int dither) {
+    dither_.Setup(dither);
+    rotate_ = ((rotate / 90) % 4 + 4) % 4 * 90;
+    mirror_ = mirror;
+    lut_identity_ = true;
+    for(int ch = 0; ch < 3; ch++) {
+        for(int v = 0; v < 256; v++) {
+            double out = 255.0 * brightness[ch] * pow(v / 255.0, gamma[ch]);
+            int o = (int)(out + 0.5);
+            if(o < 0)
+                o = 0;
+            if(o > 255)
+                o = 255;
+            if(inverted)
+                o = 255 - o;
+            lut_[ch][v] = o;
+            if(o != v)
+                lut_identity_ = false;
+        }
+    }
+}
+
+// Layout size; the device is this size turned by the rotation.
+void GraphicOutput::Resize(int rows, int cols) {
+    rows_ = rows;
+    cols_ = cols;
+}
+
+// Index into the layout of the pixel shown at device (drow, dcol). Affine,
+// so neighbours are a constant step apart.
+int GraphicOutput::Source(int drow, int dcol) {
+    int row, col;
+    switch(rotate_) {
+    case 90:
+        row = rows_ - 1 - dcol;
+        col = drow;
+        break;
+    case 180:
+        row = rows_ - 1 - drow;
+        col = cols_ - 1 - dcol;
+        break;
+    case 270:
+        row = dcol;
+        col = cols_ - 1 - drow;
+        break;
+    default:
+        row = drow;
+        col = dcol;
+        break;
+    }
+    if(mirror_)
+        col = cols_ - 1 - col;
+    return row * cols_ + col;
+}
+
+void GraphicOutput::Map(GraphicRect &rect) {
+    int row = rect.row, height = rect.height, width = rect.width;
+    int col = mirror_ ? cols_ - rect.col - width : rect.col;
+    switch(rotate_) {
+    case 90:
+        rect.row = col;
+        rect.col = rows_ - row - height;
+        rect.height = width;
+        rect.width = height;
+        break;
+    case 180:
+        rect.row = rows_ - row - height;
+        rect.col = cols_ - col - width;
+        break;
+    case 270:
+        rect.row = cols_ - col - width;
+        rect.col = row;
+        rect.height = width;
+        rect.width = height;
+        break;
+    default:
+        rect.col = col;
+        break;
+    }
+}
+
+RGBA GraphicOutput::Color(RGBA p) {
+    p.R = lut_[0][p.R];
+    p.G = lut_[1][p.G];
+    p.B = lut_[2][p.B];
+    return p;
+}
+
+// Pack the device window rect, already aligned for format, from the
+// layout fb.
+void GraphicOutput::Pack(int format, const RGBA *fb, const GraphicRect &rect,
+    uint8_t *dst, int dst_stride) {
+    int height = rect.height, width = rect.width;
+
+    int scratch = GraphicPackScratch(format, width);
+    if((int)gray_.size() < scratch)
+        gray_.resize(scratch);
+    uint8_t *gray = gray_.empty() ? NULL : &gray_[0];
+
+    dither_.Start(width);
+    if(Identity()) {
+        GraphicPack(format, fb + rect.row * cols_ + rect.col, cols_,
+            height, width, dst, dst_stride, gray, &dither_, rect.row,
+            rect.col);
+        return;
+    }
+
+    if((int)strip_.size() < TILE_SIZE * width)
+        strip_.resize(TILE_SIZE * width);
+
+    int origin = Source(rect.row, rect.col);
+    int step_x = Source(rect.row, rect.col + 1) - origin;
+    int step_y = Source(rect.row + 1, rect.col) - origin;
+
+    for(int y0 = 0; y0 < height; y0 += TILE_SIZE) {
+        int lines = height - y0 < TILE_SIZE ? height - y0 : TILE_SIZE;
+        for(int x0 = 0; x0 < width; x0 += TILE_SIZE) {
+            int span = width - x0 < TILE_SIZE ? width - x0 : TILE_SIZE;
+            for(int y = 0; y < lines; y++) {
+                const RGBA *src = fb + origin + (y0 + y) * step_y + x0 * step_x;
+                RGBA *out = &strip_[y * width + x0];
+                if(lut_identity_) {
+                    for(int x = 0; x < span; x++)
+                        out[x] = src[x * step_x];
+                } else {
+                    for(int x = 0; x < span; x++) {
+                        RGBA p = src[x * step_x];
+                        p.R = lut_[0][p.R];
+                        p.G = lut_[1][p.G];
+                        p.B = lut_[2][p.B];
+                        out[x] = p;
+                    }
+                }
+            }
+        }
+        GraphicPack(format, &strip_[0], width, lines, width,
+            dst + GraphicPackLines(format, y0) * dst_stride, dst_stride, gray,
+            &dither_, rect.row + y0, rect.col);
+    }
+}
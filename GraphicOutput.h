@@ -0,0 +1,81 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GRAPHIC_OUTPUT_H__
+#define __GRAPHIC_OUTPUT_H__
+
+#include <vector>
+#include <stdint.h>
+
+#include "RGBA.h"
+#include "GraphicDamage.h"
+#include "GraphicDither.h"
+#include "GraphicPack.h"
+
+namespace LCD {
+
+/*
+ * What happens to flattened pixels on their way to the device: a
+ * horizontal mirror, then a clockwise rotation of 0, 90, 180 or 270
+ * degrees, then a per-channel lookup table built from gamma, brightness
+ * and inversion. Map turns a window of the layout into the window of
+ * the device it lands on. Pack produces a device window in the driver's
+ * format in one pass: pixels are gathered 8x8 blocks at a time into a
+ * strip of TILE_SIZE device rows, looked up, and packed while the strip
+ * is still in cache, dithered for mono and 4-bit panels on the way.
+ * With nothing to do Pack is plain GraphicPack.
+ */
+class GraphicOutput {
+
+    int rows_;
+    int cols_;
+    int rotate_;
+    bool mirror_;
+    bool lut_identity_;
+    uint8_t lut_[3][256];
+    std::vector<RGBA> strip_;
+    std::vector<uint8_t> gray_;
+    GraphicDither dither_;
+
+    int Source(int drow, int dcol);
+
+    public:
+    GraphicOutput();
+    void Setup(int rotate, bool mirror, const double gamma[3],
+        const double brightness[3], bool inverted, int dither = DITHER_NONE);
+    void Resize(int rows, int cols);
+    bool Swaps() { return rotate_ == 90 || rotate_ == 270; }
+    bool Identity() { return rotate_ == 0 && !mirror_ && lut_identity_; }
+    int DeviceRows() { return Swaps() ? cols_ : rows_; }
+    int DeviceCols() { return Swaps() ? rows_ : cols_; }
+    // Error diffusion needs every window to be the whole frame.
+    bool WholeFrames(int format) {
+        return dither_.Mode() == DITHER_DIFFUSION && GraphicPackLevels(format);
+    }
+    void Map(GraphicRect &rect);
+    RGBA Color(RGBA p);
+    void Pack(int format, const RGBA *fb, const GraphicRect &rect,
+        uint8_t *dst, int dst_stride);
+};
+
+}; // End namespace
+
+#endif
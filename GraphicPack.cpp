@@ -0,0 +1,259 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "GraphicPack.h"
+#include "GraphicDither.h"
+
+using namespace LCD;
+
+/* x / 255 rounded down, exact for x <= 255 * 255 */
+#define DIV255(x) (((x) + 1 + ((x) >> 8)) >> 8)
+
+static inline uint32_t LoadPixel(const RGBA *src) {
+    uint32_t v;
+    memcpy(&v, src, sizeof(v));
+    return v;
+}
+
+static void PackXRGB(const RGBA *src, uint32_t *dst, int len) {
+    int n = 0;
+
+#if defined(__SSE2__)
+    const __m128i green = _mm_set1_epi32(0x0000ff00);
+    const __m128i low = _mm_set1_epi32(0x000000ff);
+    for(; n + 4 <= len; n += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + n));
+        __m128i out = _mm_or_si128(_mm_and_si128(v, green),
+            _mm_or_si128(_mm_slli_epi32(_mm_and_si128(v, low), 16),
+                _mm_and_si128(_mm_srli_epi32(v, 16), low)));
+        _mm_storeu_si128((__m128i *)(dst + n), out);
+    }
+#endif
+
+    for(; n < len; n++)
+        dst[n] = (src[n].R << 16) | (src[n].G << 8) | src[n].B;
+}
+
+static void PackRGB565(const RGBA *src, uint16_t *dst, int len) {
+    int n = 0;
+
+#if defined(__SSE2__)
+    const __m128i red = _mm_set1_epi32(0x000000f8);
+    const __m128i green = _mm_set1_epi32(0x0000fc00);
+    const __m128i blue = _mm_set1_epi32(0x0000001f);
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+    for(; n + 8 <= len; n += 8) {
+        __m128i v[2], p[2];
+        v[0] = _mm_loadu_si128((const __m128i *)(src + n));
+        v[1] = _mm_loadu_si128((const __m128i *)(src + n + 4));
+        for(int i = 0; i < 2; i++) {
+            p[i] = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(v[i], red), 8),
+                _mm_or_si128(_mm_srli_epi32(_mm_and_si128(v[i], green), 5),
+                    _mm_and_si128(_mm_srli_epi32(v[i], 19), blue)));
+            // packs saturates signed, so shift into its range and back
+            p[i] = _mm_sub_epi32(p[i], bias32);
+        }
+        __m128i out = _mm_add_epi16(_mm_packs_epi32(p[0], p[1]), bias16);
+        _mm_storeu_si128((__m128i *)(dst + n), out);
+    }
+#endif
+
+    for(; n < len; n++)
+        dst[n] = ((src[n].R >> 3) << 11) | ((src[n].G >> 2) << 5) |
+            (src[n].B >> 3);
+}
+
+static void PackGray(const RGBA *src, uint8_t *dst, int len) {
+    int n = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_set_epi16(0, 28, 150, 77, 0, 28, 150, 77);
+    const __m128i one = _mm_set1_epi32(1);
+    for(; n + 4 <= len; n += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + n));
+        // [77R + 150G, 28B] per pixel, then summed into the low half
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weights);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weights);
+        lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+        hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+        __m128i sum = _mm_unpacklo_epi64(
+            _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0)),
+            _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0)));
+        sum = _mm_add_epi32(_mm_add_epi32(sum, one), _mm_srli_epi32(sum, 8));
+        sum = _mm_srli_epi32(sum, 8);
+        sum = _mm_packus_epi16(_mm_packs_epi32(sum, zero), zero);
+        uint32_t out = _mm_cvtsi128_si32(sum);
+        memcpy(dst + n, &out, sizeof(out));
+    }
+#endif
+
+    for(; n < len; n++)
+        dst[n] = DIV255(77 * src[n].R + 150 * src[n].G + 28 * src[n].B);
+}
+
+int LCD::GraphicPackLevels(int format) {
+    switch(format) {
+    case GRAPHIC_GRAY4:
+        return 16;
+    case GRAPHIC_MONO_PAGE:
+    case GRAPHIC_MONO_ROW:
+        return 2;
+    }
+    return 0;
+}
+
+int LCD::GraphicPackStride(int format, int width) {
+    switch(format) {
+    case GRAPHIC_XRGB8888:
+        return width * 4;
+    case GRAPHIC_RGB565:
+        return width * 2;
+    case GRAPHIC_GRAY8:
+    case GRAPHIC_MONO_PAGE:
+        return width;
+    case GRAPHIC_GRAY4:
+        return (width + 1) / 2;
+    case GRAPHIC_MONO_ROW:
+        return (width + 7) / 8;
+    }
+    return 0;
+}
+
+int LCD::GraphicPackLines(int format, int height) {
+    if(format == GRAPHIC_MONO_PAGE)
+        return (height + 7) / 8;
+    return height;
+}
+
+int LCD::GraphicPackOffset(int format, int row, int col, int stride) {
+    return GraphicPackLines(format, row) * stride +
+        GraphicPackStride(format, col);
+}
+
+static void AlignAxis(int *pos, int *size, int unit, int max) {
+    int end = *pos + *size;
+    *pos -= *pos % unit;
+    end = (end + unit - 1) / unit * unit;
+    if(end > max)
+        end = max;
+    *size = end - *pos;
+}
+
+void LCD::GraphicPackAlign(int format, int *row, int *col, int *height,
+    int *width, int rows, int cols) {
+    switch(format) {
+    case GRAPHIC_GRAY4:
+        AlignAxis(col, width, 2, cols);
+        break;
+    case GRAPHIC_MONO_PAGE:
+        AlignAxis(row, height, 8, rows);
+        break;
+    case GRAPHIC_MONO_ROW:
+        AlignAxis(col, width, 8, cols);
+        break;
+    }
+}
+
+int LCD::GraphicPackScratch(int format, int width) {
+    switch(format) {
+    case GRAPHIC_GRAY4:
+        return width + 1;
+    case GRAPHIC_MONO_PAGE:
+        return width * 8;
+    case GRAPHIC_MONO_ROW:
+        return width;
+    }
+    return 0;
+}
+
+void LCD::GraphicPack(int format, const RGBA *src, int src_stride,
+    int height, int width, uint8_t *dst, int dst_stride, uint8_t *gray,
+    GraphicDither *dither, int row, int col) {
+
+    switch(format) {
+    case GRAPHIC_XRGB8888:
+        for(int r = 0; r < height; r++)
+            PackXRGB(src + r * src_stride, (uint32_t *)(dst + r * dst_stride),
+                width);
+        break;
+
+    case GRAPHIC_RGB565:
+        for(int r = 0; r < height; r++)
+            PackRGB565(src + r * src_stride, (uint16_t *)(dst + r * dst_stride),
+                width);
+        break;
+
+    case GRAPHIC_GRAY8:
+        for(int r = 0; r < height; r++)
+            PackGray(src + r * src_stride, dst + r * dst_stride, width);
+        break;
+
+    case GRAPHIC_GRAY4:
+        for(int r = 0; r < height; r++) {
+            uint8_t *out = dst + r * dst_stride;
+            PackGray(src + r * src_stride, gray, width);
+            if(dither)
+                dither->Row(gray, width, row + r, col, 16);
+            gray[width] = 0;
+            for(int c = 0; c < width; c += 2)
+                out[c / 2] = (gray[c] & 0xf0) | (gray[c + 1] >> 4);
+        }
+        break;
+
+    case GRAPHIC_MONO_PAGE:
+        for(int p = 0; p < height; p += 8) {
+            uint8_t *out = dst + p / 8 * dst_stride;
+            int lines = height - p < 8 ? height - p : 8;
+            for(int y = 0; y < lines; y++) {
+                PackGray(src + (p + y) * src_stride, &gray[y * width], width);
+                if(dither)
+                    dither->Row(&gray[y * width], width, row + p + y, col, 2);
+            }
+            for(int c = 0; c < width; c++) {
+                uint8_t bits = 0;
+                for(int y = 0; y < lines; y++)
+                    bits |= (gray[y * width + c] < 127) << y;
+                out[c] = bits;
+            }
+        }
+        break;
+
+    case GRAPHIC_MONO_ROW:
+        for(int r = 0; r < height; r++) {
+            uint8_t *out = dst + r * dst_stride;
+            PackGray(src + r * src_stride, gray, width);
+            if(dither)
+                dither->Row(gray, width, row + r, col, 2);
+            memset(out, 0, (width + 7) / 8);
+            for(int c = 0; c < width; c++)
+                out[c / 8] |= (gray[c] < 127) << (7 - c % 8);
+        }
+        break;
+    }
+}
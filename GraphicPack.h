@@ -0,0 +1,83 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GRAPHIC_PACK_H__
+#define __GRAPHIC_PACK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "RGBA.h"
+
+#define GRAPHIC_XRGB8888 0     // uint32_t 0x00RRGGBB per pixel
+#define GRAPHIC_RGB565 1       // uint16_t per pixel, host order
+#define GRAPHIC_GRAY8 2        // one byte per pixel
+#define GRAPHIC_GRAY4 3        // two pixels per byte, left one high
+#define GRAPHIC_MONO_PAGE 4    // byte = 8 rows of a column, top in bit 0
+#define GRAPHIC_MONO_ROW 5     // byte = 8 columns of a row, left in bit 7
+
+namespace LCD {
+
+class GraphicDither;
+
+/*
+ * Conversion from composited RGBA to the pixel format a driver sends to
+ * its device. Gray levels use the same weights as GraphicGray, and mono
+ * formats set a bit for dark pixels (gray < 127) as GraphicBlack did.
+ * XRGB8888, RGB565 and gray conversion work 4 to 8 pixels at a time
+ * with SSE2 when the compiler targets it, with a scalar tail. Given a
+ * dither, the gray rows of mono and 4-bit formats go through it first;
+ * row and col then place the window on the device.
+ */
+
+// Gray levels a mono or 4-bit format shows; 0 for the others.
+int GraphicPackLevels(int format);
+
+// Bytes per output line; a line is a pixel row, or a page of 8 rows
+// for GRAPHIC_MONO_PAGE.
+int GraphicPackStride(int format, int width);
+
+// Output lines covering height pixel rows.
+int GraphicPackLines(int format, int height);
+
+// Byte offset of pixel (row, col) in a packed frame; row and col must
+// be aligned as GraphicPackAlign leaves them.
+int GraphicPackOffset(int format, int row, int col, int stride);
+
+// Grow a window so it starts and ends on whole bytes of the format,
+// without leaving the rows x cols display.
+void GraphicPackAlign(int format, int *row, int *col, int *height,
+    int *width, int rows, int cols);
+
+// Bytes of scratch GraphicPack needs for a window width pixels wide;
+// 0 for formats that pack straight from RGBA.
+int GraphicPackScratch(int format, int width);
+
+// Pack a height x width window whose top left pixel is src. Gray rows
+// are staged in gray, which the caller keeps between calls and
+// sizes with GraphicPackScratch.
+void GraphicPack(int format, const RGBA *src, int src_stride, int height,
+    int width, uint8_t *dst, int dst_stride, uint8_t *gray,
+    GraphicDither *dither = NULL, int row = 0, int col = 0);
+
+}; // End namespace
+
+#endif
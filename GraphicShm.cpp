@@ -0,0 +1,172 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "GraphicShm.h"
+#include "debug.h"
+
+using namespace LCD;
+
+GraphicShm::GraphicShm() : fd_(-1), map_(NULL), size_(0) {
+}
+
+GraphicShm::~GraphicShm() {
+    Close();
+}
+
+// Always a fresh segment of our own. A leftover under the name, from a
+// run that died or another instance, is unlinked first; readers that
+// still map it keep their copy.
+bool GraphicShm::Open(std::string name) {
+    Close();
+    if(name.empty())
+        return false;
+    if(name[0] != '/')
+        name = "/" + name;
+    fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if(fd_ < 0 && errno == EEXIST) {
+        LCDInfo("GraphicShm: Replacing existing segment %s", name.c_str());
+        shm_unlink(name.c_str());
+        fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    }
+    if(fd_ < 0) {
+        LCDError("GraphicShm: shm_open(%s): %s", name.c_str(),
+            strerror(errno));
+        return false;
+    }
+    name_ = name;
+    return true;
+}
+
+// Whether name_ still refers to the segment we created.
+bool GraphicShm::Owned() {
+    struct stat ours, named;
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if(fd < 0)
+        return false;
+    bool same = fstat(fd_, &ours) == 0 && fstat(fd, &named) == 0 &&
+        ours.st_dev == named.st_dev && ours.st_ino == named.st_ino;
+    close(fd);
+    return same;
+}
+
+void GraphicShm::Close() {
+    if(map_)
+        munmap(map_, size_);
+    if(fd_ >= 0) {
+        if(Owned())
+            shm_unlink(name_.c_str());
+        close(fd_);
+    }
+    map_ = NULL;
+    size_ = 0;
+    fd_ = -1;
+}
+
+// seq goes odd before anything else is stored, and even after.
+void GraphicShm::Begin() {
+    __atomic_store_n(&Header()->seq, Header()->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void GraphicShm::End() {
+    __atomic_store_n(&Header()->seq, Header()->seq + 1, __ATOMIC_RELEASE);
+}
+
+// The segment only grows, so a reader's old mapping stays valid.
+void GraphicShm::Resize(int rows, int cols) {
+    if(!IsOpen())
+        return;
+    size_t size = sizeof(GraphicShmHeader) + (size_t)rows * cols * sizeof(RGBA);
+    if(size > size_) {
+        struct stat st;
+        if(fstat(fd_, &st) < 0 || (st.st_size < (off_t)size &&
+            ftruncate(fd_, size) < 0)) {
+            LCDError("GraphicShm: ftruncate(%s): %s", name_.c_str(),
+                strerror(errno));
+            Close();
+            return;
+        }
+        uint8_t *map = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd_, 0);
+        if(map == MAP_FAILED) {
+            LCDError("GraphicShm: mmap(%s): %s", name_.c_str(),
+                strerror(errno));
+            Close();
+            return;
+        }
+        if(map_)
+            munmap(map_, size_);
+        map_ = map;
+        size_ = size;
+    }
+
+    GraphicShmHeader *header = Header();
+    Begin();
+    header->magic = GRAPHIC_SHM_MAGIC;
+    header->version = GRAPHIC_SHM_VERSION;
+    header->header_size = sizeof(GraphicShmHeader);
+    header->format = GRAPHIC_SHM_RGBA;
+    header->rows = rows;
+    header->cols = cols;
+    header->stride = cols * sizeof(RGBA);
+    header->size = size_;
+    End();
+}
+
+void GraphicShm::Publish(const RGBA *fb, const std::vector<GraphicRect> &rects) {
+    if(!map_ || rects.empty())
+        return;
+
+    // Row bands of the rectangles, sorted and joined where they touch.
+    bands_.clear();
+    for(unsigned int i = 0; i < rects.size(); i++)
+        bands_.push_back(std::make_pair(rects[i].row,
+            rects[i].row + rects[i].height));
+    std::sort(bands_.begin(), bands_.end());
+
+    GraphicShmHeader *header = Header();
+    size_t stride = header->stride;
+    uint8_t *frame = map_ + header->header_size;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    Begin();
+    for(unsigned int i = 0; i < bands_.size(); ) {
+        int first = bands_[i].first;
+        int last = bands_[i].second;
+        for(i++; i < bands_.size() && bands_[i].first <= last; i++)
+            last = std::max(last, bands_[i].second);
+        memcpy(frame + first * stride, (const uint8_t *)fb + first * stride,
+            (last - first) * stride);
+    }
+    header->frame++;
+    header->usec = (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+    End();
+}
@@ -0,0 +1,99 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GRAPHIC_SHM_H__
+#define __GRAPHIC_SHM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "RGBA.h"
+#include "GraphicDamage.h"
+
+#define GRAPHIC_SHM_MAGIC 0x464c434c   // "LCLF" little endian
+#define GRAPHIC_SHM_VERSION 1
+#define GRAPHIC_SHM_RGBA 0             // bytes R, G, B, A per pixel
+
+namespace LCD {
+
+/*
+ * Start of the segment; the frame follows at offset header_size. All
+ * fields but seq and frame are fixed between resizes.
+ */
+typedef struct _GraphicShmHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t format;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t stride;       // bytes per row
+    uint32_t size;         // bytes of the segment, header included
+    uint32_t seq;          // odd while the writer is inside
+    uint32_t pad;
+    uint64_t frame;        // frames published so far
+    uint64_t usec;         // wall clock of the last one
+} GraphicShmHeader;
+
+/*
+ * Exports the composited frame, in layout coordinates and before the
+ * output stage, to a named POSIX shared-memory segment that other
+ * processes map read-only. Writes are bracketed by a seqlock: a reader
+ * loads seq, retries while it is odd, copies what it needs, and keeps
+ * the copy only if seq is unchanged afterwards. A reader whose mapping
+ * is smaller than size must map the segment again.
+ *
+ * Publish copies each dirty rectangle as the band of whole rows it
+ * covers, so a band is a single memcpy; overlapping bands are joined
+ * first. Only the update thread writes, under graphic_mutex_.
+ *
+ * Open always creates a new segment, and Close unlinks the name only
+ * while it still refers to that segment.
+ */
+class GraphicShm {
+
+    std::string name_;
+    int fd_;
+    uint8_t *map_;
+    size_t size_;
+    std::vector<std::pair<int, int> > bands_;
+
+    GraphicShmHeader *Header() { return (GraphicShmHeader *)map_; }
+    bool Owned();
+    void Begin();
+    void End();
+
+    public:
+    GraphicShm();
+    ~GraphicShm();
+    bool Open(std::string name);
+    void Close();
+    bool IsOpen() { return fd_ >= 0; }
+    void Resize(int rows, int cols);
+    void Publish(const RGBA *fb, const std::vector<GraphicRect> &rects);
+};
+
+}; // End namespace
+
+#endif
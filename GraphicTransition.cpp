@@ -0,0 +1,289 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "GraphicTransition.h"
+
+using namespace LCD;
+
+/* x / 255 rounded down, exact for x <= 255 * 255 */
+#define DIV255(x) (((x) + 1 + ((x) >> 8)) >> 8)
+
+void LCD::GraphicMix(RGBA *dst, const RGBA *a, const RGBA *b,
+    const uint8_t *weight, int len) {
+    int n = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i one = _mm_set1_epi16(1);
+    for(; n + 4 <= len; n += 4) {
+        uint32_t w4;
+        memcpy(&w4, weight + n, sizeof(w4));
+        // spread each pixel's weight over its four channels
+        __m128i w = _mm_cvtsi32_si128(w4);
+        w = _mm_unpacklo_epi8(w, w);
+        w = _mm_unpacklo_epi8(w, w);
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + n));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + n));
+        __m128i half[2];
+        for(int i = 0; i < 2; i++) {
+            __m128i pa = i ? _mm_unpackhi_epi8(va, zero) : _mm_unpacklo_epi8(va, zero);
+            __m128i pb = i ? _mm_unpackhi_epi8(vb, zero) : _mm_unpacklo_epi8(vb, zero);
+            __m128i pw = i ? _mm_unpackhi_epi8(w, zero) : _mm_unpacklo_epi8(w, zero);
+            __m128i x = _mm_add_epi16(_mm_mullo_epi16(pb, pw),
+                _mm_mullo_epi16(pa, _mm_sub_epi16(full, pw)));
+            x = _mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8));
+            half[i] = _mm_srli_epi16(x, 8);
+        }
+        _mm_storeu_si128((__m128i *)(dst + n), _mm_packus_epi16(half[0], half[1]));
+    }
+#endif
+
+    for(; n < len; n++) {
+        int w = weight[n];
+        dst[n].R = DIV255(b[n].R * w + a[n].R * (255 - w));
+        dst[n].G = DIV255(b[n].G * w + a[n].G * (255 - w));
+        dst[n].B = DIV255(b[n].B * w + a[n].B * (255 - w));
+        dst[n].A = DIV255(b[n].A * w + a[n].A * (255 - w));
+    }
+}
+
+void GraphicTransition::Prepare(int rows, int cols, int xres, int yres) {
+    rows_ = rows;
+    cols_ = cols;
+    xres_ = xres;
+    yres_ = yres;
+}
+
+/*
+ * The incoming layout pushes the outgoing one sideways. "both" slides
+ * alternate text rows in opposite directions.
+ */
+class TransitionSlide : public GraphicTransition {
+    int direction_;
+
+    public:
+    enum { RIGHT, LEFT, BOTH, UP, DOWN };
+
+    TransitionSlide(int direction) { direction_ = direction; }
+
+    void Render(double t, const RGBA *from, const RGBA *to, RGBA *out) {
+        if(direction_ == UP || direction_ == DOWN) {
+            int off = (int)(t * rows_ + 0.5);
+            int row = direction_ == DOWN ? off : rows_ - off;
+            const RGBA *top = direction_ == DOWN ? to + (rows_ - off) * cols_ : from + off * cols_;
+            const RGBA *bottom = direction_ == DOWN ? from : to;
+            memcpy(out, top, row * cols_ * sizeof(RGBA));
+            memcpy(out + row * cols_, bottom, (rows_ - row) * cols_ * sizeof(RGBA));
+            return;
+        }
+
+        int off = (int)(t * cols_ + 0.5);
+        for(int r = 0; r < rows_; r++) {
+            const RGBA *f = from + r * cols_;
+            const RGBA *n = to + r * cols_;
+            RGBA *o = out + r * cols_;
+            bool left = direction_ == LEFT ||
+                (direction_ == BOTH && (r / yres_) % 2 == 0);
+            if(left) {
+                memcpy(o, f + off, (cols_ - off) * sizeof(RGBA));
+                memcpy(o + cols_ - off, n, off * sizeof(RGBA));
+            } else {
+                memcpy(o, n + cols_ - off, off * sizeof(RGBA));
+                memcpy(o + off, f, (cols_ - off) * sizeof(RGBA));
+            }
+        }
+    }
+};
+
+/*
+ * The outgoing layout shrinks to a waving band around the middle row.
+ * Band edges per column come from a sine table built in Prepare. Only
+ * the pixels the edges swept past since the last frame are rewritten,
+ * plus whole rows the layouts redrew in the meantime.
+ */
+class TransitionTentacle : public GraphicTransition {
+    std::vector<float> sine_;
+    std::vector<int> top_;
+    std::vector<int> bottom_;
+    std::vector<char> dirty_;
+
+    public:
+    void Prepare(int rows, int cols, int xres, int yres) {
+        GraphicTransition::Prepare(rows, cols, xres, yres);
+        sine_.resize(1024);
+        for(int i = 0; i < 1024; i++)
+            sine_[i] = sin(i * 2 * M_PI / 1024);
+        top_.assign(cols, 0);
+        bottom_.assign(cols, 0);
+        dirty_.assign(rows, 1);
+    }
+
+    void Damage(int row, int height) {
+        for(int r = row < 0 ? 0 : row; r < row + height && r < rows_; r++)
+            dirty_[r] = 1;
+    }
+
+    void Render(double t, const RGBA *from, const RGBA *to, RGBA *out) {
+        double rate = 1.0 - t;
+        // Phase walks 0.02 rad per column and drifts over time.
+        double drift = t * 0.0002 * cols_ * cols_ / xres_;
+        int add1 = (rows_ / 2) - (rows_ / 2) * rate * 1.5;
+        int add2 = (rows_ / 2) + (rows_ / 2) * rate * 1.5;
+
+        for(int c = 0; c < cols_; c++) {
+            double phase = drift + 0.02 * c;
+            int i = (int)(phase * 1024 / (2 * M_PI)) & 1023;
+            double wave = sine_[i] * (rows_ / 4) * c / (double)cols_;
+            int y1 = (int)wave + add1;
+            int y2 = (int)wave + add2;
+            y1 = y1 < 0 ? 0 : y1 > rows_ ? rows_ : y1;
+            y2 = y2 < y1 ? y1 : y2 > rows_ ? rows_ : y2;
+
+            // Rows between the old and new edges flip sides.
+            int edges[2][2] = {
+                { top_[c] < y1 ? top_[c] : y1, top_[c] < y1 ? y1 : top_[c] },
+                { bottom_[c] < y2 ? bottom_[c] : y2, bottom_[c] < y2 ? y2 : bottom_[c] } };
+            for(int e = 0; e < 2; e++) {
+                for(int r = edges[e][0]; r < edges[e][1]; r++) {
+                    int n = r * cols_ + c;
+                    out[n] = r >= y1 && r < y2 ? from[n] : to[n];
+                }
+            }
+            top_[c] = y1;
+            bottom_[c] = y2;
+        }
+
+        for(int r = 0; r < rows_; r++) {
+            if(!dirty_[r])
+                continue;
+            dirty_[r] = 0;
+            for(int c = 0; c < cols_; c++) {
+                int n = r * cols_ + c;
+                out[n] = r >= top_[c] && r < bottom_[c] ? from[n] : to[n];
+            }
+        }
+    }
+};
+
+// The outgoing layout fades into the incoming one.
+class TransitionFade : public GraphicTransition {
+    std::vector<uint8_t> weight_;
+
+    public:
+    void Prepare(int rows, int cols, int xres, int yres) {
+        GraphicTransition::Prepare(rows, cols, xres, yres);
+        weight_.resize(cols);
+    }
+
+    void Render(double t, const RGBA *from, const RGBA *to, RGBA *out) {
+        memset(&weight_[0], (int)(t * 255), cols_);
+        for(int r = 0; r < rows_; r++)
+            GraphicMix(out + r * cols_, from + r * cols_, to + r * cols_,
+                &weight_[0], cols_);
+    }
+};
+
+// Pixels switch to the incoming layout in a fixed random order.
+class TransitionDissolve : public GraphicTransition {
+    std::vector<uint8_t> order_;
+    std::vector<uint8_t> weight_;
+
+    public:
+    void Prepare(int rows, int cols, int xres, int yres) {
+        GraphicTransition::Prepare(rows, cols, xres, yres);
+        order_.resize(rows * cols);
+        weight_.resize(rows * cols);
+        unsigned int seed = 1;
+        for(int n = 0; n < rows * cols; n++)
+            order_[n] = rand_r(&seed) % 255;
+    }
+
+    void Render(double t, const RGBA *from, const RGBA *to, RGBA *out) {
+        int level = (int)(t * 255);
+        for(int n = 0; n < rows_ * cols_; n++)
+            weight_[n] = order_[n] < level ? 255 : 0;
+        GraphicMix(out, from, to, &weight_[0], rows_ * cols_);
+    }
+};
+
+static GraphicTransition *CreateBuiltin(std::string name) {
+    if(name == "right") return new TransitionSlide(TransitionSlide::RIGHT);
+    if(name == "left") return new TransitionSlide(TransitionSlide::LEFT);
+    if(name == "both") return new TransitionSlide(TransitionSlide::BOTH);
+    if(name == "up") return new TransitionSlide(TransitionSlide::UP);
+    if(name == "down") return new TransitionSlide(TransitionSlide::DOWN);
+    if(name == "tentacle") return new TransitionTentacle();
+    if(name == "alphablend") return new TransitionFade();
+    if(name == "dissolve") return new TransitionDissolve();
+    return NULL;
+}
+
+static std::map<std::string, GraphicTransition::Factory> &Registry() {
+    static std::map<std::string, GraphicTransition::Factory> registry;
+    if(registry.empty()) {
+        const char *names[] = { "right", "left", "both", "up", "down",
+            "tentacle", "alphablend", "dissolve" };
+        for(unsigned int i = 0; i < sizeof(names) / sizeof(*names); i++)
+            registry[names[i]] = CreateBuiltin;
+    }
+    return registry;
+}
+
+static std::string Lower(std::string str) {
+    for(unsigned int i = 0; i < str.size(); i++)
+        str[i] = tolower(str[i]);
+    return str;
+}
+
+void GraphicTransition::Register(std::string name, Factory factory) {
+    Registry()[Lower(name)] = factory;
+}
+
+GraphicTransition *GraphicTransition::Create(std::string name) {
+    std::map<std::string, Factory> &registry = Registry();
+    std::string key = Lower(name);
+
+    std::map<std::string, Factory>::iterator it = registry.find(key);
+    if(it == registry.end() && key.size() > 0) {
+        // One-letter names as StartTransition reads them.
+        const char *letters = "rlbudta";
+        const char *names[] = { "right", "left", "both", "up", "down",
+            "tentacle", "alphablend" };
+        const char *p = strchr(letters, key[0]);
+        if(p)
+            it = registry.find(names[p - letters]);
+    }
+    if(it == registry.end())
+        it = registry.find("right");
+    if(it == registry.end())
+        return NULL;
+    return it->second(it->first);
+}
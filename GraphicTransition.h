@@ -0,0 +1,78 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GRAPHIC_TRANSITION_H__
+#define __GRAPHIC_TRANSITION_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "RGBA.h"
+
+namespace LCD {
+
+/*
+ * A layout transition for graphic displays. Render draws the frame at
+ * progress t, from 0 to 1, given the flattened outgoing and incoming
+ * layouts. Progress comes from the clock, not from timer ticks, so a
+ * late tick only drops a frame. Anything that doesn't depend on t
+ * (masks, tables) belongs in Prepare, which runs once per transition.
+ * Damage reports rows of from or to that changed since the last Render;
+ * an effect that keeps out between frames must redraw them.
+ *
+ * Effects are looked up by their configured name, case-insensitively,
+ * and then by its first letter for the original one-letter names.
+ * Register adds or replaces an effect.
+ */
+class GraphicTransition {
+
+    protected:
+    int rows_;
+    int cols_;
+    int xres_;
+    int yres_;
+
+    public:
+    typedef GraphicTransition *(*Factory)(std::string name);
+
+    virtual ~GraphicTransition() {}
+    virtual void Prepare(int rows, int cols, int xres, int yres);
+    virtual void Render(double t, const RGBA *from, const RGBA *to,
+        RGBA *out) = 0;
+    virtual void Damage(int row, int height) {}
+
+    static void Register(std::string name, Factory factory);
+    static GraphicTransition *Create(std::string name);
+};
+
+/*
+ * dst = (a * (255 - w) + b * w) / 255 per pixel, w taken from weight.
+ * Exact at w = 0 and w = 255, so 0/255 masks select without mixing.
+ * Works 4 pixels at a time with SSE2 when the compiler targets it.
+ */
+void GraphicMix(RGBA *dst, const RGBA *a, const RGBA *b,
+    const uint8_t *weight, int len);
+
+}; // End namespace
+
+#endif
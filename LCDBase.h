@@ -23,6 +23,7 @@
 #define __LCD_BASE__
 
 #include <string>
+#include <sys/time.h>
 
 namespace LCD {
 
@@ -33,6 +34,12 @@ class LCDBase {
     virtual void SignalTransitionStart(std::string layout) = 0;
     virtual void SignalTransitionEnd() = 0;
     virtual int ResizeLCD(int rows, int cols) = 0;
+    // Draw layout's widgets off screen ahead of a transition; false if
+    // the display can't.
+    virtual bool SignalWarmStart(std::string layout) { return false; }
+    virtual void SignalWarmStop() {}
+    // When the warm layout's first draw landed; false if none has yet.
+    virtual bool WarmDrawn(struct timeval *when) { return false; }
     int XRES;
     int YRES;
     int LROWS;
@@ -34,7 +34,10 @@
 #include "DrvPicoGraphic.h"
 #include "DrvLCDProc.h"
 #include "DrvSDL.h"
+#include "DrvNull.h"
+#include "DrvNullGraphic.h"
 #include "Evaluator.h"
+#include "PluginLoader.h"
 #include "debug.h"
 #include <X11/Xlib.h>
 
@@ -43,6 +46,11 @@ using namespace LCD;
 LCDControl::LCDControl(QApplication *app) {
     app_ = app;
     active_ = true;
+    sources_ = new PluginLoader();
+    wrapper_ = new LCDControlWrapper((LCDControlInterface *)this);
+    sample_timer_ = new QTimer();
+    QObject::connect(sample_timer_, SIGNAL(timeout()),
+        wrapper_, SLOT(SampleSources()));
 }
 
 LCDControl::~LCDControl() {
@@ -53,6 +61,14 @@ LCDControl::~LCDControl() {
         if(devices_.find(*it) != devices_.end() && devices_[*it])
             delete devices_[*it];
     }
+    sample_timer_->stop();
+    delete sample_timer_;
+    delete wrapper_;
+    delete sources_;
+}
+
+void LCDControl::SampleSources() {
+    sources_->SampleAll();
 }
 
 int LCDControl::Start() {
@@ -140,6 +156,11 @@ void LCDControl::ProcessVariables(Json::Value *config, Evaluator *ev) {
 void LCDControl::ConfigSetup() {
     if(!CFG_Get_Root()) return;
 
+    if(sources_->Setup(CFG_Get_Root(), CFG_Dir()) > 0) {
+        sources_->SampleAll();
+        sample_timer_->start(sources_->Interval());
+    }
+
     Json::Value::Members keys = CFG_Get_Root()->getMemberNames();
 
     for(std::vector<std::string>::iterator it = keys.begin(); it != keys.end(); it++ ) {
@@ -195,6 +216,12 @@ void LCDControl::ConfigSetup() {
             } else if(driver->asString() == "sdl") {
                 devices_[*it] = new DrvSDL(*it, this, CFG_Get_Root(),
                     layers->asInt());
+            } else if(driver->asString() == "null") {
+                devices_[*it] = new DrvNull(*it, this, CFG_Get_Root(),
+                    rows->asInt(), cols->asInt(), layers->asInt());
+            } else if(driver->asString() == "nullgraphic") {
+                devices_[*it] = new DrvNullGraphic(*it, this, CFG_Get_Root(),
+                    rows->asInt(), cols->asInt(), layers->asInt());
             } else if(driver->asString() == "lcdproc") {
                 devices_[*it] = new DrvLCDProc(*it, this, CFG_Get_Root(), layers->asInt());
             } else {
@@ -25,6 +25,7 @@
 #include <map>
 #include <vector>
 #include <QApplication>
+#include <QTimer>
 #include <json/json.h>
 
 #include "CFG.h"
@@ -33,13 +34,34 @@ namespace LCD {
 
 class LCDCore;
 class Evaluator;
+class PluginLoader;
 
-class LCDControl : public CFG {
+class LCDControlInterface {
+    public:
+    virtual ~LCDControlInterface() {}
+    virtual void SampleSources() = 0;
+};
+
+class LCDControlWrapper : public QObject {
+    Q_OBJECT
+    LCDControlInterface *wrappedObject_;
+    public:
+    LCDControlWrapper(LCDControlInterface *obj) { wrappedObject_ = obj; }
+    public slots:
+    void SampleSources() { wrappedObject_->SampleSources(); }
+};
+
+class LCDControl : public CFG, public LCDControlInterface {
 
     QApplication *app_;
     bool active_;
     std::map<std::string, LCDCore *> devices_;
     std::vector<std::string> display_keys_;
+    // Data sources are loaded once and sampled on one tick for every
+    // display, so all expressions on a tick see the same tables.
+    PluginLoader *sources_;
+    LCDControlWrapper *wrapper_;
+    QTimer *sample_timer_;
     void ConfigSetup();
 
     public:
@@ -50,6 +72,8 @@ class LCDControl : public CFG {
     void Shutdown();
     LCDCore *FindDisplay(std::string name);
     void ProcessVariables(Json::Value *config, Evaluator *ev);
+    PluginLoader *GetSources() { return sources_; }
+    void SampleSources();
     bool IsActive() { return active_; }
 };
 
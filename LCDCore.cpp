@@ -24,6 +24,7 @@
 #include <string>
 #include <sstream>
 #include <map>
+#include <algorithm>
 #include <stdlib.h>
 #include <iostream>
 
@@ -38,6 +39,7 @@
 #include "LCDGraphic.h"
 #include "LCDWrapper.h"
 #include "PluginLCD.h"
+#include "PluginPSI.h"
 
 #include "Widget.h"
 #include "WidgetText.h"
@@ -62,6 +64,11 @@ LCDCore::LCDCore(LCDControl *app, std::string name, Json::Value *config, int t,
     lcd_ = lcd;
     name_ = name;
     layout_timeout_ = 0;
+    transition_duration_ = 0;
+    transition_lead_ = 0;
+    warm_count_ = 0;
+    warm_in_time_ = 0;
+    warm_missed_ = 0;
     transitions_off_ = false;
     // initialize true so property initialization doesn't trigger transitions
     is_transitioning_ = false;
@@ -70,6 +77,9 @@ LCDCore::LCDCore(LCDControl *app, std::string name, Json::Value *config, int t,
     timer_->setSingleShot(true);
     transition_timer_ = new QTimer();
     transition_timer_->setSingleShot(false);
+    warm_timer_ = new QTimer();
+    warm_timer_->setSingleShot(true);
+    QObject::connect(warm_timer_, SIGNAL(timeout()), wrapper_, SLOT(WarmLayout()));
     QObject::connect(timer_, SIGNAL(timeout()), wrapper_, SLOT(ChangeLayout()));
     QObject::connect(transition_timer_, SIGNAL(timeout()), wrapper_,
         SLOT(LayoutTransition()));
@@ -77,7 +87,10 @@ LCDCore::LCDCore(LCDControl *app, std::string name, Json::Value *config, int t,
         wrapper_, SLOT(TransitionFinished()));
     QObject::connect(wrapper_, SIGNAL(_KeypadEvent(const int)),
         wrapper_, SLOT(KeypadEvent(const int)));
+    QObject::connect(wrapper_, SIGNAL(_PressureEvent(const int)),
+        wrapper_, SLOT(PressureEvent(const int)));
     gen_index_ = 0;
+    pressure_ = NULL;
 
     pluginLCD = new PluginLCD(this);
     QScriptValue val = engine_->newObject();
@@ -91,12 +104,16 @@ LCDCore::LCDCore(LCDControl *app, std::string name, Json::Value *config, int t,
 }
 
 LCDCore::~LCDCore() {
+    if(pressure_)
+        delete pressure_;
     delete wrapper_;
     delete pluginLCD;
     timer_->stop();
     transition_timer_->stop();
+    warm_timer_->stop();
     delete timer_;
     delete transition_timer_;
+    delete warm_timer_;
     for(std::map<std::string, Widget *>::iterator w = widgets_.begin(); 
         w != widgets_.end(); w++) {
         delete w->second;
@@ -113,6 +130,7 @@ void LCDCore::CFGSetup() {
     std::string str;
 
     app_->ProcessVariables(CFG_Get_Root(), (Evaluator *)this);
+    AddSources(app_->GetSources());
 
     Json::Value *section = CFG_Fetch_Raw(CFG_Get_Root(), name_);
     if(!section) {
@@ -128,6 +146,10 @@ void LCDCore::CFGSetup() {
     transition_speed_ = val->asInt();
     delete val;
 
+    val = CFG_Fetch(section, "transition-lead", new Json::Value(500));
+    transition_lead_ = val->asInt();
+    delete val;
+
     val = CFG_Fetch_Raw(section, "clear_on_layout_change", new Json::Value(true));
     clear_on_layout_change_ = val->asBool();
     delete val;
@@ -136,6 +158,8 @@ void LCDCore::CFGSetup() {
     transitions_off_ = val->asBool();
     delete val;
 
+    PressureSetup(section);
+
     Json::Value *layout = CFG_Fetch_Raw(section, "layout0");
 
     while(layout) {
@@ -339,9 +363,40 @@ void LCDCore::BuildLayouts() {
            delete type;
        }
    }
+   if(type_ == LCD_TEXT)
+       PlanChars();
+}
+
+// Collect the special chars each layout's widgets will ask for, so the
+// text display can keep glyphs that follow layouts share in place.
+void LCDCore::PlanChars() {
+    std::vector<CharCache::Plan> plans;
+    for(unsigned int i = 0; i < layouts_.size(); i++ ) {
+        CharCache::Plan plan;
+        std::vector<SpecialChar> glyphs;
+        plan.layout = layouts_[i];
+        plan.privates = 0;
+        for(std::map<std::string,Widget *>::iterator w = widgets_.begin(); 
+            w != widgets_.end(); w++) {
+            if(!(w->second->GetType() & WIDGET_TYPE_SPECIAL) ||
+                (w->second->GetLayoutBase() != layouts_[i] &&
+                w->second->GetLayoutBase() != name_))
+                continue;
+            plan.privates += w->second->PlanChars(glyphs);
+        }
+        for(unsigned int g = 0; g < glyphs.size(); g++) {
+            if(std::find(plan.glyphs.begin(), plan.glyphs.end(), glyphs[g]) ==
+                plan.glyphs.end())
+                plan.glyphs.push_back(glyphs[g]);
+        }
+        plans.push_back(plan);
+    }
+    ((LCDText *)lcd_)->TextPlanChars(plans);
 }
 
-void LCDCore::StartLayout(std::string key) {
+// With warmed, the layout's own widgets were started by WarmLayout and
+// are left running; only the display's widgets and the timers start.
+void LCDCore::StartLayout(std::string key, bool warmed) {
     if(key == "") {
         gen_(current_layout_, last_layout_);
     } else {
@@ -355,6 +410,9 @@ void LCDCore::StartLayout(std::string key) {
         w != widgets.end(); w++){
 
 	if(!w->second) LCDError("w->second is null");
+        if(warmed && w->second &&
+            w->second->GetLayoutBase() == current_layout_)
+            continue;
     	if(w->second && (current_layout_ == w->second->GetLayoutBase() || w->second->GetLayoutBase() == name_ )) {
             if( type_ == LCD_TEXT &&
                 (w->second->GetType() & WIDGET_TYPE_SPECIAL)) {
@@ -373,6 +431,20 @@ void LCDCore::StartLayout(std::string key) {
     if(timeout->asInt() > 0)
         timer_->start(timeout->asInt());
 
+    // Warm the next layout up shortly before its transition starts.
+    Json::Value *transition = CFG_Fetch_Raw(CFG_Get_Root(),
+        current_layout_ + ".transition");
+    Json::Value *lead = CFG_Fetch(CFG_Get_Root(),
+        current_layout_ + ".transition-lead", new Json::Value(transition_lead_));
+    if(timeout->asInt() > 0 && transition && !transitions_off_ &&
+        lead->asInt() > 0 && layouts_.size() > 1) {
+        int at = timeout->asInt() - lead->asInt();
+        warm_timer_->start(at > 0 ? at : 0);
+    }
+    delete lead;
+    if(transition)
+        delete transition;
+
     delete timeout;
 
     Json::Value *val = CFG_Fetch_Raw(CFG_Get_Root(), current_layout_ + 
@@ -417,6 +489,42 @@ void LCDCore::ChangeLayout() {
     }
 }
 
+// The layout gen_ yields next, without advancing it.
+std::string LCDCore::PeekLayout() {
+    int i = gen_index_;
+    if(i < 0 || i >= (int)layouts_.size())
+        i = 0;
+    return layouts_[i];
+}
+
+void LCDCore::WarmLayout() {
+    if(is_transitioning_ || layouts_.empty())
+        return;
+
+    std::string next = PeekLayout();
+    if(next == current_layout_ || next == warm_layout_)
+        return;
+    if(!lcd_->SignalWarmStart(next))
+        return;
+
+    warm_layout_ = next;
+    warm_count_++;
+    gettimeofday(&warm_start_, NULL);
+
+    std::map<std::string, Widget *> widgets = widgets_;
+    for(std::map<std::string,Widget *>::iterator w = widgets.begin();
+        w != widgets.end(); w++) {
+        if(w->second && w->second->GetLayoutBase() == next)
+            w->second->Start();
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    LCDInfo("%s: started <%s> for warm-up in %d ms", name_.c_str(),
+        next.c_str(), (int)((now.tv_sec - warm_start_.tv_sec) * 1000 +
+        (now.tv_usec - warm_start_.tv_usec) / 1000));
+}
+
 void LCDCore::Transition(int i) {
     if(is_transitioning_)
         return;
@@ -459,14 +567,49 @@ void LCDCore::StartTransition(std::string transition) {
             break;
     }
     gen_(current_layout_, last_layout_);
-    lcd_->SignalTransitionStart(current_layout_);
+    warm_timer_->stop();
+    bool warmed = warm_layout_ != "" && warm_layout_ == current_layout_;
+    if(warmed) {
+        // In time if the layout had drawn by the time its transition began;
+        // widgets that evaluate asynchronously may not have.
+        struct timeval drawn;
+        if(lcd_->WarmDrawn(&drawn)) {
+            warm_in_time_++;
+            LCDInfo("%s: <%s> first drew %d ms into its warm-up, "
+                "%lu of %lu in time", name_.c_str(), current_layout_.c_str(),
+                (int)((drawn.tv_sec - warm_start_.tv_sec) * 1000 +
+                (drawn.tv_usec - warm_start_.tv_usec) / 1000),
+                warm_in_time_, warm_count_);
+        } else {
+            LCDInfo("%s: <%s> had not drawn when its transition started, "
+                "%lu of %lu in time", name_.c_str(), current_layout_.c_str(),
+                warm_in_time_, warm_count_);
+        }
+    } else {
+        // Keypad switches may pick a layout other than the warm one.
+        if(warm_layout_ != "") {
+            StopLayout(warm_layout_);
+            lcd_->SignalWarmStop();
+        }
+        warm_missed_++;
+        LCDInfo("%s: <%s> started cold, %lu transitions without warm-up",
+            name_.c_str(), current_layout_.c_str(), warm_missed_);
+    }
+    warm_layout_ = "";
     direction_ = t;
-    StartLayout(current_layout_);
-    is_transitioning_ = true;
+    transition_ = transition;
     Json::Value *val = CFG_Fetch_Raw(CFG_Get_Root(), 
         current_layout_ + ".transition-speed", new Json::Value(transition_speed_));
     int speed = val->asInt();
     delete val;
+    // Same length as the old one-step-per-character sweep by default.
+    val = CFG_Fetch_Raw(CFG_Get_Root(), current_layout_ + ".transition-duration",
+        new Json::Value(speed * lcd_->LCOLS / (lcd_->XRES > 0 ? lcd_->XRES : 1)));
+    transition_duration_ = val->asInt();
+    delete val;
+    lcd_->SignalTransitionStart(current_layout_);
+    StartLayout(current_layout_, warmed);
+    is_transitioning_ = true;
     transition_timer_->setInterval(speed);
     transition_timer_->start();
     LayoutTransition();
@@ -509,12 +652,89 @@ void LCDCore::KeypadEvent(const int key) {
     }
 }
 
+// "pressure": { "memory": { "full": false, "stall": 50, "window": 1000,
+//     "layout": "layout_mem", "widgets": ["mem_text"] } }
+void LCDCore::PressureSetup(Json::Value *section) {
+    Json::Value *pressure = CFG_Fetch_Raw(section, "pressure");
+    if(!pressure)
+        return;
+
+    for(int r = 0; r < PRESSURE_RESOURCES; r++) {
+        Json::Value *cfg = CFG_Fetch_Raw(pressure, PluginPSI::ResourceName(r));
+        if(!cfg)
+            continue;
+
+        if(!pressure_)
+            pressure_ = new PressureWatcher(this);
+
+        // The trigger fires once stall msec of stall accumulate, which
+        // bounds how late we react.
+        Json::Value *val = CFG_Fetch(cfg, "stall", new Json::Value(50));
+        int stall = val->asInt();
+        delete val;
+
+        val = CFG_Fetch(cfg, "window", new Json::Value(1000));
+        int window = val->asInt();
+        delete val;
+
+        val = CFG_Fetch_Raw(cfg, "full", new Json::Value(false));
+        bool full = val->asBool();
+        delete val;
+
+        if(pressure_->AddTrigger(r, full, stall, window) < 0) {
+            delete cfg;
+            continue;
+        }
+
+        pressure_action action;
+        val = CFG_Fetch_Raw(cfg, "layout", new Json::Value(""));
+        action.layout = val->asString();
+        delete val;
+
+        val = CFG_Fetch_Raw(cfg, "widgets");
+        for(unsigned int i = 0; val && val->isArray() && i < val->size(); i++)
+            action.widgets.push_back((*val)[i].asString());
+        if(val) delete val;
+
+        pressure_actions_[r] = action;
+        delete cfg;
+    }
+    delete pressure;
+
+    if(pressure_)
+        pressure_->Start();
+}
+
+void LCDCore::PressureEvent(const int resource) {
+    std::map<int, pressure_action>::iterator it = 
+        pressure_actions_.find(resource);
+
+    if(it == pressure_actions_.end())
+        return;
+
+    LCDInfo("PressureEvent(%s) %s", PluginPSI::ResourceName(resource), 
+        current_layout_.c_str());
+
+    if(it->second.layout != "" && it->second.layout != current_layout_)
+        SelectLayout(it->second.layout);
+
+    for(unsigned int i = 0; i < it->second.widgets.size(); i++) {
+        for(std::map<std::string, Widget *>::iterator w = widgets_.begin();
+            w != widgets_.end(); w++) {
+            if(w->second->GetWidgetBase() == it->second.widgets[i] &&
+                w->second->GetLayoutBase() == current_layout_)
+                w->second->Update();
+        }
+    }
+}
+
 int LCDCore::ResizeLCD(int rows, int cols) {
     StopLayout(current_layout_);
     int old_rows = lcd_->LROWS;
     int old_cols = lcd_->LCOLS;
     if(lcd_->ResizeLCD(rows, cols) == 0) {
-        emit static_cast<LCDEvents *>(wrapper_)->_ResizeLCD(rows, cols, old_rows, old_cols);
+        emit static_cast<LCDEvents *>(wrapper_)->_ResizeLCD(lcd_->LROWS,
+            lcd_->LCOLS, old_rows, old_cols);
     } else {
         LCDError("LCDCore::ResizeLCD: Unable to resize LCD");
         return -1;
@@ -32,6 +32,7 @@
 #include <sstream>
 #include <map>
 #include <stdlib.h>
+#include <sys/time.h>
 #include <iostream>
 #include <QObject>
 
@@ -57,6 +58,13 @@ namespace LCD {
 class PluginLCD;
 class LCDControl;
 
+class PressureWatcher;
+
+struct pressure_action {
+    std::string layout;
+    std::vector<std::string> widgets;
+};
+
 struct widget_template {
     std::string key;
     int row;
@@ -75,6 +83,8 @@ class LCDCore: public virtual Evaluator, public CFG, public LCDInterface {
     int type_;
     int layout_timeout_;
     int transition_speed_;
+    int transition_duration_;
+    std::string transition_;
     int direction_;
     bool is_transitioning_;
     bool clear_on_layout_change_;
@@ -82,8 +92,19 @@ class LCDCore: public virtual Evaluator, public CFG, public LCDInterface {
     LCDWrapper *wrapper_;
     QTimer *timer_;
     QTimer *transition_timer_;
+    QTimer *warm_timer_;
+    int transition_lead_;
+    std::string warm_layout_;
+    struct timeval warm_start_;
+    unsigned long warm_count_;
+    unsigned long warm_in_time_;
+    unsigned long warm_missed_;
+    std::string PeekLayout();
     PluginLCD *pluginLCD;
     LCDControl *app_;
+    PressureWatcher *pressure_;
+    std::map<int, pressure_action> pressure_actions_;
+    void PressureSetup(Json::Value *section);
 
     protected:
     LCDBase *lcd_;
@@ -95,7 +116,8 @@ class LCDCore: public virtual Evaluator, public CFG, public LCDInterface {
     virtual ~LCDCore();
     virtual void CFGSetup();
     void BuildLayouts();
-    void StartLayout(std::string key = "");
+    void PlanChars();
+    void StartLayout(std::string key = "", bool warmed = false);
     int GetType() { return type_; }
     LCDBase *GetLCD() { return lcd_; }
     virtual void Connect(){};
@@ -106,6 +128,8 @@ class LCDCore: public virtual Evaluator, public CFG, public LCDInterface {
     LCDWrapper *GetWrapper() { return wrapper_; }
     std::vector<std::string> GetLayouts() { return layouts_; }
     int GetDirection() { return direction_; }
+    std::string GetTransition() { return transition_; }
+    int GetTransitionDuration() { return transition_duration_; }
     std::string GetCurrentLayout() { return current_layout_; }
     std::string GetLastLayout() { return last_layout_; }
     std::string GetName() { return name_; }
@@ -116,13 +140,16 @@ class LCDCore: public virtual Evaluator, public CFG, public LCDInterface {
     void LayoutChangeBefore() {}
     void LayoutChangeAfter() {}
     void TextSpecialCharChanged(int i) {}
+    void TextFlush() {}
     void ChangeLayout();
+    void WarmLayout();
     void StopLayout(std::string layout);
     void StartTransition(std::string transition);
     void LayoutTransition();
     void TransitionFinished();
     void Transition(int);
     void KeypadEvent(const int k);
+    void PressureEvent(const int resource);
     int ResizeLCD(int row, int col);
     void SelectLayout(std::string layout);
     int RemoveWidget(std::string name);
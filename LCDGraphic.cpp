@@ -36,6 +36,8 @@
 #include "LCDCore.h"
 #include "LCDGraphic.h"
 #include "RGBA.h"
+#include "GraphicComposite.h"
+#include "GraphicTransition.h"
 #include "CFG.h"
 #include "WidgetText.h"
 #include "WidgetBar.h"
@@ -54,10 +56,22 @@
 using namespace LCD;
 using namespace std;
 
-extern int Font_6x8[256][8];
-extern int Font_6x8_bold[256][8];
 extern int VISUALIZATION_CHARS[6][9];
 
+// A number for all three channels, or an array of red, green and blue.
+static void FetchChannels(LCDCore *v, std::string key, double def,
+    double out[3]) {
+    Json::Value *val = v->CFG_Fetch_Raw(v->CFG_Get_Root(),
+        v->GetName() + "." + key, new Json::Value(def));
+    for(int ch = 0; ch < 3; ch++) {
+        if(val->isArray())
+            out[ch] = (*val)[val->size() > (unsigned)ch ? ch : 0].asDouble();
+        else
+            out[ch] = val->asDouble();
+    }
+    delete val;
+}
+
 LCDGraphic::LCDGraphic(LCDCore *v) : 
     FG_COL(0x00, 0x00, 0x00, 0xFF),
     BG_COL(0xFF, 0xFF, 0xFF, 0xFF),
@@ -107,11 +121,52 @@ LCDGraphic::LCDGraphic(LCDCore *v) :
         v->GetName() + ".inverted", new Json::Value(0));
     INVERTED = val->asInt();
     delete val;
+
+    // Rotation, mirroring, gamma, brightness and inversion are all
+    // applied as pixels are packed for the driver.
+    val = v->CFG_Fetch(v->CFG_Get_Root(),
+        v->GetName() + ".rotate", new Json::Value(0));
+    int rotate = val->asInt();
+    delete val;
+
+    val = v->CFG_Fetch(v->CFG_Get_Root(),
+        v->GetName() + ".mirror", new Json::Value(0));
+    bool mirror = val->asInt();
+    delete val;
+
+    double gamma[3], brightness[3];
+    FetchChannels(v, "gamma", 1.0, gamma);
+    FetchChannels(v, "brightness", 1.0, brightness);
+
+    val = v->CFG_Fetch_Raw(v->CFG_Get_Root(),
+        v->GetName() + ".dither", new Json::Value("none"));
+    std::string mode = val->asString();
+    delete val;
+    int dither = DITHER_NONE;
+    if(mode == "ordered")
+        dither = DITHER_ORDERED;
+    else if(mode == "diffusion")
+        dither = DITHER_DIFFUSION;
+    else if(mode != "none")
+        LCDError("%s: ignoring unknown dither '%s'",
+            v->GetName().c_str(), mode.c_str());
+
+    output_.Setup(rotate, mirror, gamma, brightness, INVERTED, dither);
+
+    // Name of a shared-memory segment to export frames to, if any.
+    val = v->CFG_Fetch_Raw(v->CFG_Get_Root(),
+        v->GetName() + ".shm", new Json::Value(""));
+    shm_.Open(val->asString());
+    delete val;
     
     GraphicRealBlit = NULL;
+    GraphicRealBlitRects = NULL;
+    PIXEL_FORMAT = GRAPHIC_XRGB8888;
+    FRAME_QUEUE = false;
 
-    transition_tick_ = 0;
-    transitioning_ = false;
+    transitioning_.fetchAndStoreOrdered(0);
+    warm_drawn_ = false;
+    effect_ = NULL;
 
     //QObject::connect(&wrapper_, SIGNAL(_GraphicUpdate(int, int, int, int)),
     //    &wrapper_, SLOT(GraphicUpdate(int, int, int, int)));
@@ -141,6 +196,8 @@ LCDGraphic::~LCDGraphic() {
     free(DisplayFB);
     free(LayoutFB);
     free(TransitionFB);
+    free(CompositeFB);
+    delete effect_;
 }
 
 void LCDGraphic::LayoutChangeBefore() {
@@ -151,19 +208,25 @@ void LCDGraphic::LayoutChangeAfter() {
 }
 
 void LCDGraphic::GraphicStart() {
-    is_resizing_ = false;
+    resizing_.fetchAndStoreOrdered(0);
     update_thread_->start();
 }
 
-void LCDGraphic::GraphicInit(const int rows, const int cols,
+void LCDGraphic::GraphicInit(const int drows, const int dcols,
     const int yres, const int xres, const int layers, const bool clear_on_layout_change) {
+    // drows x dcols is the device; the layout is turned by the rotation.
+    const int rows = output_.Swaps() ? dcols : drows;
+    const int cols = output_.Swaps() ? drows : dcols;
 cout << "rows " << rows << " cols " << cols << "-----------======================\n";
     LROWS = rows;
     LCOLS = cols;
+    DROWS = drows;
+    DCOLS = dcols;
     YRES = yres;
     XRES = xres;
     LAYERS = layers;
     clear_on_layout_change_ = clear_on_layout_change;
+    atlas_.Resize(xres, yres);
 
     DisplayFB = (RGBA **)malloc(sizeof(RGBA) * layers * rows * cols);
 
@@ -183,6 +246,8 @@ cout << "rows " << rows << " cols " << cols << "-----------=====================
         TransitionFB[l] = (RGBA *)malloc(sizeof(RGBA) * rows * cols);
     }
 
+    CompositeFB = (RGBA *)malloc(sizeof(RGBA) * rows * cols);
+
     /*
     DisplayFB.resize(layers);
     LayoutFB.resize(layers);
@@ -201,15 +266,30 @@ cout << "rows " << rows << " cols " << cols << "-----------=====================
         }
     }
 
-    update_window_.R = rows - 1;
-    update_window_.C = cols - 1;
-    update_window_.H = 0;
-    update_window_.W = 0;
+    layers_.Resize(rows, cols, layers);
+    output_.Resize(rows, cols);
+    CompositeWindow(0, 0, rows, cols);
+
+    damage_.Resize(rows, cols);
+    frames_.Resize(drows, dcols);
+    shm_.Resize(rows, cols);
 }
 
-int LCDGraphic::ResizeLCD(int rows, int cols) {
+// A resize is a new frame generation; the driver keeps presenting its
+// old frame until one at the new size is published.
+int LCDGraphic::ResizeLCD(int drows, int dcols) {
+    int rows = output_.Swaps() ? dcols : drows;
+    int cols = output_.Swaps() ? drows : dcols;
     RGBA *tmp;
 
+    graphic_mutex_.lock();
+    tmp = (RGBA *)realloc(CompositeFB, rows * cols * sizeof(RGBA));
+    if(!tmp) {
+        graphic_mutex_.unlock();
+        return -1;
+    }
+    CompositeFB = tmp;
+
     for(int l = 0; l < LAYERS; l++) {
         free(DisplayFB[l]);
         free(LayoutFB[l]);
@@ -218,18 +298,21 @@ int LCDGraphic::ResizeLCD(int rows, int cols) {
         if(tmp) {
             DisplayFB[l] = tmp;
         } else {
+            graphic_mutex_.unlock();
             return -1;
         }
         tmp = (RGBA *)malloc(rows * cols * sizeof(RGBA));
         if(tmp) {
             LayoutFB[l] = tmp;
         } else {
+            graphic_mutex_.unlock();
             return -1;
         }
         tmp = (RGBA *)malloc(rows * cols * sizeof(RGBA));
         if(tmp) {
             TransitionFB[l] = tmp;
         } else {
+            graphic_mutex_.unlock();
             return -1;
         }
         for(int n = 0; n  < rows * cols; n++) {
@@ -241,78 +324,160 @@ int LCDGraphic::ResizeLCD(int rows, int cols) {
             TransitionFB[l][n] = NO_COL;
         }
     }
-    LROWS = update_window_.H = rows;
-    DROWS = rows;
-    LCOLS = update_window_.W = cols;
-    DCOLS = cols;
-    update_window_.R = 0;
-    update_window_.C = 0;
+    LROWS = rows;
+    DROWS = drows;
+    LCOLS = cols;
+    DCOLS = dcols;
+    layers_.Resize(rows, cols, LAYERS);
+    output_.Resize(rows, cols);
+    CompositeWindow(0, 0, rows, cols);
+    damage_mutex_.lock();
+    damage_.Resize(rows, cols);
+    damage_.Mark(0, 0, rows, cols);
+    damage_mutex_.unlock();
+    frames_.Resize(drows, dcols);
+    shm_.Resize(rows, cols);
+    graphic_mutex_.unlock();
     return 0;
 }
 
 void LCDGraphic::ResizeBefore(int rows, int cols) {
-    is_resizing_ = true;
+    resizing_.fetchAndStoreOrdered(1);
 }
 
 void LCDGraphic::ResizeAfter() {
-    is_resizing_ = false;
+    resizing_.fetchAndStoreOrdered(0);
 }
 
 #define max(a, b) ((a>b)?a:b)
 #define min(a, b) ((a<b)?a:b)
 
 void LCDGraphic::GraphicUpdate(int row, int col, int height, int width) {
+    damage_mutex_.lock();
+    damage_.Mark(row, col, height, width);
+    damage_mutex_.unlock();
+}
 
-    int y1 = row + height;
-    int x1 = col + width;
-    int y2 = update_window_.R + update_window_.H;
-    int x2 = update_window_.C + update_window_.W;
+// Damage from a widget of layout. While transitioning, Transition()
+// recomposites just the rows marked here instead of the update thread.
+// A warming layout draws offscreen, so its damage is dropped.
+void LCDGraphic::GraphicMark(std::string layout, int row, int col,
+    int height, int width) {
+    if(warm_layout_ != "" && layout == warm_layout_)
+        return;
+    if(!IsTransitioning()) {
+        GraphicUpdate(row, col, height, width);
+        return;
+    }
+    std::vector<char> &dirty = layout == transition_layout_ ? to_dirty_ : from_dirty_;
+    for(int r = max(0, row); r < row + height && r < (int)dirty.size(); r++)
+        dirty[r] = 1;
+}
 
-    //row = max((int)LROWS - 1, row);
-    //col = max((int)LCOLS - 1, col);
+void LCDGraphic::GraphicDraw() {
+    while(visitor_->IsActive()) {
+        if(resizing_.fetchAndAddOrdered(0) || IsTransitioning()) {
+            usleep(refresh_rate_ * 1000);
+            continue;
+        }
 
-    if(y1 > y2)
-        update_window_.H = (y1 - y2) + height;
-    if(x1 > x2)
-        update_window_.W = (x1 - x2) + width;;
+        damage_mutex_.lock();
+        bool damaged = damage_.Take(damaged_);
+        damage_mutex_.unlock();
 
-    if(row < update_window_.R) {
-        update_window_.R = row;
+        if(damaged) {
+            graphic_mutex_.lock();
+            GraphicFlush();
+            graphic_mutex_.unlock();
+        }
+        usleep(refresh_rate_ * 1000);
     }
-    if(col < update_window_.C) {
-        update_window_.C = col;
+}
+
+// Composite the damaged tiles and send the ones whose pixels changed.
+void LCDGraphic::GraphicFlush() {
+    if(!GraphicRealBlit && !GraphicRealBlitRects && !FRAME_QUEUE &&
+        !shm_.IsOpen())
+        return;
+
+    flush_times_.Start();
+    for(unsigned int i = 0; i < damaged_.size(); i++) {
+        GraphicRect &rect = damaged_[i];
+        MergeLayout(rect.row, rect.col, rect.height, rect.width);
+        flush_times_.Lap(FLUSH_MERGE);
+        CompositeWindow(rect.row, rect.col, rect.height, rect.width);
+        flush_times_.Lap(FLUSH_COMPOSITE);
     }
 
-/*
-    int tmp = max((int)LROWS - 1, row + height);
-    int delta = LROWS - tmp;
-    update_window_.H-=delta;
+    damage_mutex_.lock();
+    damage_.Changed(CompositeFB, damaged_, changed_);
+    damage_mutex_.unlock();
+    flush_times_.Lap(FLUSH_DAMAGE);
+    if(changed_.empty())
+        return;
 
-    tmp = max((int)LCOLS - 1, col + width);
-    delta = LCOLS - tmp;
-    update_window_.W-=delta;
-*/
+    GraphicDeliver(changed_);
 }
 
-void LCDGraphic::GraphicDraw() {
-    while(visitor_->IsActive()) {
-        if(update_window_.H == 0 || update_window_.W == 0 || 
-            is_resizing_ || transitioning_) {
-            usleep(refresh_rate_ * 1000);
-            continue;
+// Publish rects of CompositeFB as a frame, export them, blit them, or
+// any of those together.
+void LCDGraphic::GraphicDeliver(std::vector<GraphicRect> &rects) {
+    if(output_.WholeFrames(PIXEL_FORMAT)) {
+        GraphicRect all = { 0, 0, LROWS, LCOLS, NULL, 0 };
+        rects.assign(1, all);
+    }
+    shm_.Publish(CompositeFB, rects);
+    if(FRAME_QUEUE)
+        frames_.Publish(PIXEL_FORMAT, output_, CompositeFB, rects);
+    flush_times_.Lap(FLUSH_PUBLISH);
+    if(!GraphicRealBlit && !GraphicRealBlitRects)
+        return;
+
+    // Pack every rectangle into one buffer before handing any out.
+    std::vector<int> offsets(rects.size());
+    int size = 0;
+    for(unsigned int i = 0; i < rects.size(); i++) {
+        GraphicRect &rect = rects[i];
+        output_.Map(rect);
+        GraphicPackAlign(PIXEL_FORMAT, &rect.row, &rect.col,
+            &rect.height, &rect.width, DROWS, DCOLS);
+        rect.stride = GraphicPackStride(PIXEL_FORMAT, rect.width);
+        offsets[i] = size;
+        size += rect.stride * GraphicPackLines(PIXEL_FORMAT, rect.height);
+    }
+    if((int)pack_.size() < size)
+        pack_.resize(size);
+    for(unsigned int i = 0; i < rects.size(); i++) {
+        GraphicRect &rect = rects[i];
+        rect.data = &pack_[offsets[i]];
+        output_.Pack(PIXEL_FORMAT, CompositeFB, rect, &pack_[offsets[i]],
+            rect.stride);
+    }
+    flush_times_.Lap(FLUSH_PACK);
+
+    if(GraphicRealBlitRects) {
+        GraphicRealBlitRects(this, &rects[0], rects.size());
+    } else {
+        for(unsigned int i = 0; i < rects.size(); i++) {
+            GraphicRect &rect = rects[i];
+            GraphicRealBlit(this, rect.row, rect.col, rect.height,
+                rect.width, rect.data, rect.stride);
         }
-	
-        graphic_mutex_.lock();
-        GraphicBlit(update_window_.R, update_window_.C, update_window_.H, update_window_.W);
-        graphic_mutex_.unlock();
-        update_window_.R = LROWS - 1;
-        update_window_.C = LCOLS - 1;
-        update_window_.H = 0;
-        update_window_.W = 0;
-        usleep(refresh_rate_ * 1000);
     }
 }
 
+// Send a window of CompositeFB to the driver.
+void LCDGraphic::GraphicSend(int row, int col, int height, int width) {
+    int r, c, h, w;
+    GraphicWindow(row, height, LROWS, &r, &h);
+    GraphicWindow(col, width, LCOLS, &c, &w);
+    if(h <= 0 || w <= 0)
+        return;
+    GraphicRect rect = { r, c, h, w, NULL, 0 };
+    std::vector<GraphicRect> rects(1, rect);
+    GraphicDeliver(rects);
+}
+
 void LCDGraphic::GraphicWindow(int pos, int size, int max, int *wpos, int *wsize)
 {
     int p1 = pos;
@@ -336,79 +501,66 @@ void LCDGraphic::GraphicWindow(int pos, int size, int max, int *wpos, int *wsize
 
 void LCDGraphic::GraphicBlit(const int row, const int col, const int height, const int width)
 {
-    if (GraphicRealBlit) {
+    if (GraphicRealBlit || GraphicRealBlitRects || FRAME_QUEUE ||
+        shm_.IsOpen()) {
         int r, c, h, w;
+        graphic_mutex_.lock();
         GraphicWindow(row, height, LROWS, &r, &h);
         GraphicWindow(col, width, LCOLS, &c, &w);
         if (h > 0 && w > 0) {
-            for(int rr = r; rr < r + h; rr++) {
-                for(int cc = c; cc < c + w; cc++) {
-                    for(int l = LAYERS - 1; l >= 0; l-- ) {
-                        if(LayoutFB[l][rr * LCOLS + cc] != NO_COL)
-                            DisplayFB[l][rr * LCOLS + cc] = 
-                                LayoutFB[l][rr * LCOLS + cc];
-                    }
+            flush_times_.Start();
+            MergeLayout(r, c, h, w);
+            flush_times_.Lap(FLUSH_MERGE);
+            CompositeWindow(r, c, h, w);
+            flush_times_.Lap(FLUSH_COMPOSITE);
+            damage_mutex_.lock();
+            damage_.Store(CompositeFB, r, c, h, w);
+            damage_mutex_.unlock();
+            flush_times_.Lap(FLUSH_DAMAGE);
+            GraphicSend(r, c, h, w);
+        }
+        graphic_mutex_.unlock();
+    }
+}
+
+// Copy the drawn pixels of a window of LayoutFB into DisplayFB, noting
+// which layers of which tiles actually changed.
+void LCDGraphic::MergeLayout(int row, int col, int height, int width)
+{
+    for(int rr = row; rr < row + height; rr++) {
+        for(int cc = col; cc < col + width; cc++) {
+            for(int l = LAYERS - 1; l >= 0; l-- ) {
+                RGBA &src = LayoutFB[l][rr * LCOLS + cc];
+                RGBA &dst = DisplayFB[l][rr * LCOLS + cc];
+                if(src != NO_COL && dst != src) {
+                    dst = src;
+                    layers_.Touch(l, rr, cc);
                 }
             }
-            GraphicRealBlit(this, r, c, h, w);
         }
     }
 }
 
-inline RGBA LCDGraphic::GraphicBlend(const int row, const int col, RGBA **buffer)
+// Flatten a window of DisplayFB into CompositeFB.
+void LCDGraphic::CompositeWindow(int row, int col, int height, int width)
+{
+    int r, c, h, w;
+    GraphicWindow(row, height, LROWS, &r, &h);
+    GraphicWindow(col, width, LCOLS, &c, &w);
+    layers_.Composite(CompositeFB, DisplayFB, BL_COL, false, r, c, h, w);
+}
+
+RGBA LCDGraphic::GraphicBlend(const int row, const int col, RGBA **buffer)
 {
-    int l, o;
-    RGBA p;
     RGBA ret;
 
     if(buffer == NULL)
         buffer = DisplayFB;
 
-    ret.R = BL_COL.R;
-    ret.G = BL_COL.G;
-    ret.B = BL_COL.B;
-    ret.A = 0x00;
-
-    /* find first opaque layer */
-    /* layers below are fully covered */
-    o = LAYERS - 1;
-    for (l = 0; l < (int)LAYERS; l++) {
-        p = buffer[l][row * LCOLS + col];
-        if (p.A == 255) {
-            o = l;
-            break;
-        }
-    }
-
-    for (l = o; l >= 0; l--) {
-        p = buffer[l][row * LCOLS + col];
-        switch(p.A) {
-        //if(p.A == 255) {
-        case 0:
-        break;
-        case 255:
-            ret.R = p.R;
-            ret.G = p.G;
-            ret.B = p.B;
-            ret.A = 0xff;
-            break;
-        //} else if(p.A != 0) {
-        default:
-            ret.R = (p.R * p.A + ret.R * (255 - p.A)) / 255;
-            ret.G = (p.G * p.A + ret.G * (255 - p.A)) / 255;
-            ret.B = (p.B * p.A + ret.B * (255 - p.A)) / 255;
-            ret.A = 0xff;
-            break;
-        //}
-        }
-    }
-    if (INVERTED) {
-        ret.R = 255 - ret.R;
-        ret.G = 255 - ret.G;
-        ret.B = 255 - ret.B;
-    }
+    GraphicComposite(&ret, buffer, LAYERS, row * LCOLS + col, 1,
+        BL_COL, false);
 
-    return ret;
+    return output_.Color(ret);
 }
 
 
@@ -440,10 +592,7 @@ void LCDGraphic::GraphicRender(const int layer, const int row, const int col,
 
     RGBA **fb;
 
-    if(IsTransitioning() && layout == GetTransitionLayout())
-        fb = TransitionFB;
-    else
-        fb = LayoutFB;
+    fb = GraphicBuffer(layout);
 
     if(offset < 0 && c < LCOLS - 2) {
         c+=XRES-(XRES+offset);
@@ -454,23 +603,15 @@ void LCDGraphic::GraphicRender(const int layer, const int row, const int col,
     /* render text into layout FB */
 
     while( *txt != '\0') {
-        int *chr;
+        const RGBA *glyph = atlas_.Glyph(bold, fg, bg, *(unsigned char *)txt);
 
-        if(bold) {
-            chr = Font_6x8_bold[(int) *(unsigned char *) txt];
-        } else {
-            chr = Font_6x8[(int) *(unsigned char *) txt];
-        }
+        /* clip the glyph's columns to the display */
+        int x0 = c < 0 ? -c : 0;
+        int x1 = c + XRES > LCOLS ? LCOLS - c : XRES;
 
-        for (y = 0; y < YRES && y + r < LROWS; y++) {
-            int mask = 1 << XRES;
-            for (x = 0; x < XRES && x + c < LCOLS; x++) {
-                mask >>= 1;
-                if (chr[y] & mask)
-                    fb[layer][(r + y) * LCOLS + c + x] = fg;
-                else
-                    fb[layer][(r + y) * LCOLS + c + x] = bg;
-            }
+        for (y = 0; y < YRES && y + r < LROWS && x0 < x1; y++) {
+            memcpy(fb[layer] + (r + y) * LCOLS + c + x0, glyph + y * XRES + x0,
+                (x1 - x0) * sizeof(RGBA));
         }
         c += XRES;
         if (offset > 0 && strlen(txt) == 1) {
@@ -484,11 +625,11 @@ void LCDGraphic::GraphicRender(const int layer, const int row, const int col,
     }
 
     /* flush area */
-    if(!transitioning_)
-        GraphicUpdate(row, col, YRES, XRES * len);
+    GraphicMark(layout, row, col, YRES, XRES * len);
 }
 
 void LCDGraphic::GraphicClear() {
+    graphic_mutex_.lock();
     for (int l = 0; l < LAYERS; l++) {
         for (int i = 0; i < LCOLS * LROWS; i++) {
             DisplayFB[l][i] = NO_COL;
@@ -496,17 +637,24 @@ void LCDGraphic::GraphicClear() {
             TransitionFB[l][i] = NO_COL;
         }
     }
+    layers_.Invalidate();
+    from_dirty_.assign(from_dirty_.size(), 1);
+    to_dirty_.assign(to_dirty_.size(), 1);
+    graphic_mutex_.unlock();
 
     GraphicUpdate(0, 0, LROWS, LCOLS);
     GraphicBlit(0, 0, LROWS, LCOLS);
 }
 
 void LCDGraphic::GraphicFill() {
+    graphic_mutex_.lock();
     for(int i = 0; i < LCOLS * LROWS; i++) {
         DisplayFB[0][i] = BG_COL;
         LayoutFB[0][i] = BG_COL;
         TransitionFB[0][i] = BG_COL;
     }
+    layers_.Invalidate();
+    graphic_mutex_.unlock();
 
     GraphicBlit(0, 0, LROWS, LCOLS);
 }
@@ -514,13 +662,13 @@ void LCDGraphic::GraphicFill() {
 
 RGBA LCDGraphic::GraphicRGB(const int row, const int col)
 {
-    return GraphicBlend(row, col);
+    return output_.Color(CompositeFB[row * LCOLS + col]);
 }
 
 
 unsigned char LCDGraphic::GraphicGray(const int row, const int col)
 {
-    RGBA p = GraphicBlend(row, col);
+    RGBA p = GraphicRGB(row, col);
     return (77 * p.R + 150 * p.G + 28 * p.B) / 255;
 }
 
@@ -536,10 +684,7 @@ void LCDGraphic::DrawSpecialChar(const int row, const int col,
 
    RGBA *fb;
 
-    if(IsTransitioning() && layout == GetTransitionLayout())
-        fb = TransitionFB[layer];
-    else
-        fb = LayoutFB[layer];
+    fb = GraphicBuffer(layout)[layer];
 
     for(int y = row; y < row + height; y++) {
         int mask = 1 << width;
@@ -598,11 +743,7 @@ void LCD::GraphicIconDraw(WidgetIcon *w) {
 
     RGBA *fb;
 
-    if(lcd->IsTransitioning() &&
-        w->GetLayoutBase() == lcd->GetTransitionLayout())
-        fb = lcd->TransitionFB[layer];
-    else
-        fb = lcd->LayoutFB[layer];
+    fb = lcd->GraphicBuffer(w->GetLayoutBase())[layer];
 
     lcd->graphic_mutex_.lock();
 
@@ -626,8 +767,7 @@ void LCD::GraphicIconDraw(WidgetIcon *w) {
     lcd->graphic_mutex_.unlock();
 
     /* flush area */
-    if(!lcd->IsTransitioning())
-        lcd->GraphicUpdate(row, col, lcd->YRES, lcd->XRES);
+    lcd->GraphicMark(w->GetLayoutBase(), row, col, lcd->YRES, lcd->XRES);
 }
 
 void LCD::GraphicBarDraw(WidgetBar *w) {
@@ -678,11 +818,7 @@ void LCD::GraphicBarDraw(WidgetBar *w) {
 
     RGBA **fb;
 
-    if(lcd->IsTransitioning() &&
-        w->GetLayoutBase() == lcd->GetTransitionLayout())
-        fb = lcd->TransitionFB;
-    else
-        fb = lcd->LayoutFB;
+    fb = lcd->GraphicBuffer(w->GetLayoutBase());
 
     switch (dir) {
     case DIR_WEST:
@@ -746,12 +882,11 @@ void LCD::GraphicBarDraw(WidgetBar *w) {
 
     /* flush area */
     if (dir & (DIR_EAST | DIR_WEST)) {
-        if(!lcd->IsTransitioning())
-
-            lcd->GraphicUpdate(row, col, lcd->YRES, lcd->XRES * len);
+        lcd->GraphicMark(w->GetLayoutBase(), row, col, lcd->YRES,
+            lcd->XRES * len);
     } else {
-        if(!lcd->IsTransitioning())
-            lcd->GraphicUpdate(row, col, lcd->YRES * len, lcd->XRES);
+        lcd->GraphicMark(w->GetLayoutBase(), row, col, lcd->YRES * len,
+            lcd->XRES);
     }
 
 }
@@ -779,11 +914,7 @@ void LCD::GraphicHistogramDraw(WidgetHistogram *w) {
 
     RGBA *fb;
 
-    if(lcd->IsTransitioning() &&
-        w->GetLayoutBase() == lcd->GetTransitionLayout())
-        fb = lcd->TransitionFB[layer];
-    else
-        fb = lcd->LayoutFB[layer];
+    fb = lcd->GraphicBuffer(w->GetLayoutBase())[layer];
 
     lcd->graphic_mutex_.lock();
     for(int c = 0; c < width / lcd->XRES; c++) {
@@ -812,8 +943,7 @@ void LCD::GraphicHistogramDraw(WidgetHistogram *w) {
     }
     lcd->graphic_mutex_.unlock();
 
-    if(!lcd->IsTransitioning())
-        lcd->GraphicUpdate(row, col, height, width);
+    lcd->GraphicMark(w->GetLayoutBase(), row, col, height, width);
 }
 
 void LCD::GraphicBignumsDraw(WidgetBignums *w) {
@@ -835,11 +965,7 @@ void LCD::GraphicBignumsDraw(WidgetBignums *w) {
 
     RGBA *fb;
 
-    if(lcd->IsTransitioning() &&
-        w->GetLayoutBase() == lcd->GetTransitionLayout())
-        fb = lcd->TransitionFB[layer];
-    else
-        fb = lcd->LayoutFB[layer];
+    fb = lcd->GraphicBuffer(w->GetLayoutBase())[layer];
 
     lcd->graphic_mutex_.lock();
     for(int r = 0; r < 16 && row + r < lcd->LROWS; r++) {
@@ -854,8 +980,7 @@ void LCD::GraphicBignumsDraw(WidgetBignums *w) {
     }
     lcd->graphic_mutex_.unlock();
 
-   if(!lcd->IsTransitioning())
-        lcd->GraphicUpdate(row, col, 16, 24);
+    lcd->GraphicMark(w->GetLayoutBase(), row, col, 16, 24);
 }
 
 void LCD::GraphicGifDraw(WidgetGif *w) {
@@ -883,11 +1008,7 @@ void LCD::GraphicGifDraw(WidgetGif *w) {
 
     RGBA **fb;
 
-    if(lcd->IsTransitioning() &&
-        w->GetLayoutBase() == lcd->GetTransitionLayout())
-        fb = lcd->TransitionFB;
-    else
-        fb = lcd->LayoutFB;
+    fb = lcd->GraphicBuffer(w->GetLayoutBase());
 
     lcd->graphic_mutex_.lock();
     for( y = 0; y < height && row + y < lcd->LROWS; y++ ) {
@@ -903,8 +1024,7 @@ void LCD::GraphicGifDraw(WidgetGif *w) {
     lcd->graphic_mutex_.unlock();
 
 
-    if(!lcd->IsTransitioning())
-        lcd->GraphicUpdate(row, col, height, width);
+    lcd->GraphicMark(w->GetLayoutBase(), row, col, height, width);
 }
 
 void GraphicVisualizationPeakDraw(WidgetVisualization *widget) {
@@ -922,11 +1042,7 @@ void GraphicVisualizationPeakDraw(WidgetVisualization *widget) {
 
     RGBA *fb;
 
-    if(lcd->IsTransitioning() &&
-        widget->GetLayoutBase() == lcd->GetTransitionLayout())
-        fb = lcd->TransitionFB[layer];
-    else
-        fb = lcd->LayoutFB[layer];
+    fb = lcd->GraphicBuffer(widget->GetLayoutBase())[layer];
 
     lcd->graphic_mutex_.lock();
     for(int y = 0; y < height && row + y < lcd->LROWS; y++) {
@@ -1019,11 +1135,7 @@ void GraphicVisualizationPCMDraw(WidgetVisualization *widget) {
 
     RGBA *fb;
 
-    if(lcd->IsTransitioning() &&
-        widget->GetLayoutBase() == lcd->GetTransitionLayout())
-        fb = lcd->TransitionFB[layer];
-    else
-        fb = lcd->LayoutFB[layer];
+    fb = lcd->GraphicBuffer(widget->GetLayoutBase())[layer];
 
     lcd->graphic_mutex_.lock();
     for(int r = 0; r < height && row + r < lcd->LROWS; r++) {
@@ -1046,8 +1158,7 @@ void GraphicVisualizationPCMDraw(WidgetVisualization *widget) {
     }    
     lcd->graphic_mutex_.unlock();
 
-   if(!lcd->IsTransitioning())
-        lcd->GraphicUpdate(row, col, height, width);
+    lcd->GraphicMark(widget->GetLayoutBase(), row, col, height, width);
 }
 
 void GraphicVisualizationSpectrumDraw(WidgetVisualization *w) {
@@ -1084,9 +1195,8 @@ void GraphicVisualizationSpectrumDraw(WidgetVisualization *w) {
     }
     lcd->graphic_mutex_.unlock();
 
-   if(!lcd->IsTransitioning())
-        lcd->GraphicUpdate(row * lcd->YRES, col * lcd->XRES, 
-            height * lcd->YRES, width * lcd->XRES);
+    lcd->GraphicMark(w->GetLayoutBase(), row * lcd->YRES, col * lcd->XRES,
+        height * lcd->YRES, width * lcd->XRES);
 
 }
 
@@ -1116,11 +1226,7 @@ void GraphicNiftyDraw(WidgetNifty *widget) {
 
     RGBA *fb;
 
-    if(lcd->IsTransitioning() &&
-        widget->GetLayoutBase() == lcd->GetTransitionLayout())
-        fb = lcd->TransitionFB[layer];
-    else
-        fb = lcd->LayoutFB[layer];
+    fb = lcd->GraphicBuffer(widget->GetLayoutBase())[layer];
 
     for(int r = 0; r < height && row + r < lcd->LROWS; r++) {
         for(int c = 0; c < width && col + c < lcd->LCOLS; c++) {
@@ -1134,221 +1240,120 @@ void GraphicNiftyDraw(WidgetNifty *widget) {
 
 }
 */
-void LCDGraphic::Transition() {
-    switch(visitor_->GetDirection()) {
-    case TRANSITION_LEFT:
-    case TRANSITION_RIGHT:
-    case TRANSITION_BOTH:
-        TransitionLeftRight();
-        break;
-    case TRANSITION_UP:
-    case TRANSITION_DOWN:
-        TransitionUpDown();
-        break;
-    case TRANSITION_TENTACLE:
-        TransitionTentacle();
-        break;
-    case TRANSITION_ALPHABLEND:
-        TransitionAlphaBlend();
-        break;
-    default:
-        TransitionLeftRight();
-    }
-}
-
-void LCDGraphic::TransitionLeftRight() {
-    int direction = visitor_->GetDirection();
-    int col;
-    RGBA **left, **right;
-
-    for(int row = 0; row < LROWS / YRES; row++) {
-        if( direction == TRANSITION_LEFT ||
-            (direction == TRANSITION_BOTH && row % 2 == 0)) {
-            col = LCOLS - transition_tick_ - XRES - 1;
-            left = LayoutFB;
-            right = TransitionFB;
-        } else if( direction == TRANSITION_RIGHT || direction == TRANSITION_BOTH) {
-            col = transition_tick_;
-            left = TransitionFB;
-            right = LayoutFB;
-        } else {
-            col = transition_tick_;
-            left = TransitionFB;
-            right = LayoutFB;
-            LCDError("LCDGraphic: Bad transition direction: %d", direction);
-        }
-
-        if(col < 0)
-            col = 0;
-        
-        if(col + XRES >= LCOLS)
-            col-=LCOLS-col;
-
-        for(int i = 0; i < YRES; i++) {
-            int n = (row * YRES + i) * LCOLS;
-            for(int l = 0; l < LAYERS; l++) {
-                memcpy(DisplayFB[l] + n, left[l] + n + (LCOLS - col), 
-                    col * sizeof(RGBA));
-                memcpy(DisplayFB[l] + n + col + XRES, right[l] + n, 
-                    (LCOLS - col - XRES) * sizeof(RGBA));
-            }
-        }
-        GraphicRealBlit(this, row * YRES, 0, YRES, LCOLS);
-    }
-
-    transition_tick_+=XRES;
-    if( transition_tick_ >= (int)LCOLS) {
-        transition_tick_ = 0;
-        emit static_cast<LCDEvents *>(
-            visitor_->GetWrapper())->_TransitionFinished();
-        for(int l = 0; l < LAYERS; l++) {
-            memcpy(LayoutFB[l], TransitionFB[l], LCOLS * LROWS * sizeof(RGBA));
-            for(int n = 0; n < LCOLS * LROWS; n++)
-                TransitionFB[l][n] = NO_COL;
+// Buffer widgets of layout draw into.
+RGBA **LCDGraphic::GraphicBuffer(std::string layout) {
+    if(IsTransitioning() && layout == transition_layout_)
+        return TransitionFB;
+    if(warm_layout_ != "" && layout == warm_layout_) {
+        if(!warm_drawn_) {
+            warm_drawn_ = true;
+            gettimeofday(&warm_first_, NULL);
         }
-        if(fill_) {
-            for(int n = 0; n < LCOLS * LROWS; n++)
-                TransitionFB[0][n] = BG_COL;
-        }
-        transitioning_ = false;
-        GraphicBlit(0, 0, LROWS, LCOLS);
+        return TransitionFB;
     }
-    LCDError("TransitionLeftRight %d", transition_tick_);
+    return LayoutFB;
 }
 
-void LCDGraphic::TransitionUpDown() {
-    int direction = visitor_->GetDirection();
-    int row;
-    RGBA **top, **bottom;
-
-    if(direction == TRANSITION_UP) {
-        top = LayoutFB;
-        bottom = TransitionFB;
-        row = LROWS - transition_tick_ - YRES;
-    } else {
-        top = TransitionFB;
-        bottom = LayoutFB;
-        row = transition_tick_;
-    }
-
-    int o = row * LCOLS;
-
-    LCDError("o: %d, row: %d", o, row);
-
-    for(int r = 0; r < LROWS; r+=YRES) {
-        int n = r * LCOLS;
-        for(int rr = 0; rr < YRES && r + rr < LROWS; rr++) {
-            int nn = n + rr * LCOLS;
-            for(int l =0; l < LAYERS; l++) {
-                if(row <= (int)r)
-                    memcpy(DisplayFB[l] + nn, bottom[l] + nn - o, LCOLS * sizeof(RGBA));
-                else
-                    memcpy(DisplayFB[l] + nn, top[l] + nn - o, LCOLS * sizeof(RGBA));
-            }
-            GraphicRealBlit(this, r, 0, YRES, LCOLS);
-        }
-    }
-
-    transition_tick_+=YRES;
-    if( transition_tick_ >= (int)LROWS) {
-
-        transition_tick_ = 0;
-        emit static_cast<LCDEvents *>(
-            visitor_->GetWrapper())->_TransitionFinished();
-        for(int l = 0; l < LAYERS; l++) {
-            memcpy(LayoutFB[l], TransitionFB[l], LCOLS * LROWS * sizeof(RGBA));
-            for(int n = 0; n < LROWS * LCOLS; n++) {
-                TransitionFB[l][n] = NO_COL;
-            }
-        }
-        if(fill_) {
-            for(int n = 0; n < LCOLS * LROWS; n++) 
-                TransitionFB[0][n] = BG_COL;
-        }
-        transitioning_ = false;
-        GraphicBlit(0, 0, LROWS, LCOLS);
-        LCDError("Transition finished");
-        return;
-    }
-    LCDError("Transition iteration finished");
+bool LCDGraphic::SignalWarmStart(std::string layout) {
+    warm_layout_ = layout;
+    warm_drawn_ = false;
+    return true;
 }
 
-void LCDGraphic::SaneCoords(int *x, int *y1, int *y2) {
-    if(*x >= (int)LCOLS)
-        *x = LCOLS - 1;
-    else if(*x < 0)
-        *x = 0;
-
-    if(*y1 >= (int)LROWS)
-        *y1 = LROWS - 1;
-    else if(*y1 < 0) 
-        *y1 = 0;
-
-    if(*y2 >= (int)LROWS)
-        *y2 = LROWS - 1;
-    else if(*y2 < 0)
-        *y2 = 0;
+bool LCDGraphic::WarmDrawn(struct timeval *when) {
+    if(warm_layout_ == "" || !warm_drawn_)
+        return false;
+    *when = warm_first_;
+    return true;
 }
 
-void LCDGraphic::VlineFromBuffer(RGBA *dest, RGBA *src, int x, int y1, int y2) {
-    
-    SaneCoords(&x, &y1, &y2);
-
-    for(int i = y1; i < y2; i++)
-        dest[i * LCOLS + x] = src[i * LCOLS + x];
+void LCDGraphic::SignalWarmStop() {
+    warm_layout_ = "";
+    graphic_mutex_.lock();
+    for(int l = 0; l < LAYERS; l++)
+        for(int n = 0; n < LROWS * LCOLS; n++)
+            TransitionFB[l][n] = NO_COL;
+    graphic_mutex_.unlock();
 }
 
-void LCDGraphic::TransitionTentacle() {
-    int height1;
-    int height2;
-    int add1;
-    int add2;
+void LCDGraphic::SignalTransitionStart(std::string layout) {
+    transitioning_.fetchAndStoreOrdered(1);
+    transition_layout_ = layout;
+    warm_layout_ = "";
+
+    delete effect_;
+    effect_ = GraphicTransition::Create(visitor_->GetTransition());
+    effect_->Prepare(LROWS, LCOLS, XRES, YRES);
+    from_.resize(LROWS * LCOLS);
+    to_.resize(LROWS * LCOLS);
+    from_dirty_.assign(LROWS, 1);
+    to_dirty_.assign(LROWS, 1);
+    gettimeofday(&transition_start_, NULL);
+}
 
-    float sinrate = tentacle_move_;
-    float multiplier = 0;
-    float multiadd = 1.000 / LCOLS;
-    float rate = (LCOLS - transition_tick_) / (double)LCOLS;
+void LCDGraphic::Transition() {
+    if(!IsTransitioning() || !effect_)
+        return;
 
-    int i, l;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    double elapsed = (now.tv_sec - transition_start_.tv_sec) * 1000.0 +
+        (now.tv_usec - transition_start_.tv_usec) / 1000.0;
+    int duration = visitor_->GetTransitionDuration();
+    double t = duration > 0 ? elapsed / duration : 1.0;
 
-    for(l = 0; l < LAYERS; l++) {
-        memcpy(DisplayFB[l], TransitionFB[l], LROWS * LCOLS * sizeof(RGBA));
+    if(t >= 1.0) {
+        TransitionEnd();
+        return;
     }
 
-    for(i = 0; i < LCOLS; i++) {
-        add1 = (LROWS / 2) - ((LROWS / 2) * (rate * 1.5));
-        add2 = (LROWS / 2) + ((LROWS / 2) * (rate * 1.5));
-
-        height1 = (sin(sinrate) * ((LROWS / 4) * multiplier)) + add1;
-        height2 = (sin(sinrate) * ((LROWS / 4) * multiplier)) + add2;
-        multiplier += multiadd;
-
-        for(l = 0; l < LAYERS; l++) {
-            VlineFromBuffer(DisplayFB[l], LayoutFB[l], i, height1, height2); 
-        }
-        sinrate += 0.02;
-        tentacle_move_ += 0.0002;
+    graphic_mutex_.lock();
+    flush_times_.Start();
+    if((int)from_dirty_.size() != LROWS) {
+        effect_->Prepare(LROWS, LCOLS, XRES, YRES);
+        from_.resize(LROWS * LCOLS);
+        to_.resize(LROWS * LCOLS);
+        from_dirty_.assign(LROWS, 1);
+        to_dirty_.assign(LROWS, 1);
+    }
+    // Only rows drawn to since the last frame need flattening again.
+    for(int r = 0; r < LROWS; r++) {
+        if(!from_dirty_[r] && !to_dirty_[r])
+            continue;
+        if(from_dirty_[r])
+            GraphicComposite(&from_[r * LCOLS], LayoutFB, LAYERS, r * LCOLS,
+                LCOLS, BL_COL, false);
+        if(to_dirty_[r])
+            GraphicComposite(&to_[r * LCOLS], TransitionFB, LAYERS, r * LCOLS,
+                LCOLS, BL_COL, false);
+        from_dirty_[r] = to_dirty_[r] = 0;
+        effect_->Damage(r, 1);
     }
+    effect_->Render(t, &from_[0], &to_[0], CompositeFB);
+    flush_times_.Lap(FLUSH_COMPOSITE);
+    GraphicSend(0, 0, LROWS, LCOLS);
+    graphic_mutex_.unlock();
+}
 
-    transition_tick_+=XRES;
-    if( transition_tick_ >= (int)LCOLS) {
-        transition_tick_ = 0;
-        emit static_cast<LCDEvents *>(
-            visitor_->GetWrapper())->_TransitionFinished();
-        for(int l = 0; l < LAYERS; l++) {
-            memcpy(LayoutFB[l], TransitionFB[l], LCOLS * LROWS * sizeof(RGBA));
-            for(int n = 0; n < LCOLS * LROWS; n++)
-                TransitionFB[l][n] = NO_COL;
-        }
-        if(fill_) {
-            for(int n = 0; n < LCOLS * LROWS; n++) 
-                TransitionFB[0][n] = BG_COL;
-        }
-        transitioning_ = false;
-        GraphicBlit(0, 0, LROWS, LCOLS);
-        return;
+// The incoming layout becomes the layout; send it whole.
+void LCDGraphic::TransitionEnd() {
+    graphic_mutex_.lock();
+    for(int l = 0; l < LAYERS; l++) {
+        memcpy(LayoutFB[l], TransitionFB[l], LCOLS * LROWS * sizeof(RGBA));
+        memcpy(DisplayFB[l], TransitionFB[l], LCOLS * LROWS * sizeof(RGBA));
+        for(int n = 0; n < LCOLS * LROWS; n++)
+            TransitionFB[l][n] = NO_COL;
+    }
+    if(fill_) {
+        for(int n = 0; n < LCOLS * LROWS; n++)
+            TransitionFB[0][n] = BG_COL;
     }
-    GraphicRealBlit(this, 0, 0, LROWS, LCOLS);
+    transitioning_.fetchAndStoreOrdered(0);
+    layers_.Invalidate();
+    graphic_mutex_.unlock();
+    GraphicBlit(0, 0, LROWS, LCOLS);
+    emit static_cast<LCDEvents *>(
+        visitor_->GetWrapper())->_TransitionFinished();
 }
 
 RGBA LCDGraphic::BlendRGBA(RGBA col1, RGBA col2, uint8_t alpha) {
@@ -1361,48 +1366,3 @@ RGBA LCDGraphic::BlendRGBA(RGBA col1, RGBA col2, uint8_t alpha) {
 
     return ret;
 }
-
-void LCDGraphic::AlphaBlendBuffer(RGBA **dest, RGBA **src1, RGBA **src2, float alpha) {
-    uint8_t ialpha = (alpha * 255);
-
-    for(int row = 0; row < LROWS; row++) {
-        for(int col = 0; col < LCOLS; col++) {
-            RGBA col1 = GraphicBlend(row, col, src1);
-            RGBA col2 = GraphicBlend(row, col, src2);
-            dest[0][row * LCOLS + col] = BlendRGBA(col1, col2, ialpha);
-        }
-    }
-}
-
-void LCDGraphic::TransitionAlphaBlend() {
-
-    float rate = (LCOLS - transition_tick_) / (float)LCOLS;
-
-    for(int n = 0; n < LROWS * LCOLS; n++)
-        for(int l = 0; l < LAYERS; l++)
-            DisplayFB[l][n] = NO_COL;
-
-    AlphaBlendBuffer(DisplayFB, LayoutFB, TransitionFB, rate);
-
-    transition_tick_+=XRES;
-    if( transition_tick_ >= (int)LCOLS) {
-        transition_tick_ = 0;
-        emit static_cast<LCDEvents *>(
-            visitor_->GetWrapper())->_TransitionFinished();
-        for(int l = 0; l < LAYERS; l++) {
-            memcpy(LayoutFB[l], TransitionFB[l], LCOLS * LROWS * sizeof(RGBA));
-            for(int n = 0; n < LCOLS * LROWS; n++) {
-                DisplayFB[l][n] = NO_COL;
-                TransitionFB[l][n] = NO_COL;
-            }
-        }
-        if(fill_) {
-            for(int n = 0; n < LCOLS * LROWS; n++) 
-                TransitionFB[0][n] = BG_COL;
-        }
-        transitioning_ = false;
-        GraphicBlit(0, 0, LROWS, LCOLS);
-        return;
-    }
-    GraphicRealBlit(this, 0, 0, LROWS, LCOLS);
-}
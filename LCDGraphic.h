@@ -27,9 +27,27 @@
 #include <string>
 #include <vector>
 #include <sys/time.h>
+#include <QMutex>
+#include <QAtomicInt>
 
 #include "RGBA.h"
 #include "LCDBase.h"
+#include "GraphicDamage.h"
+#include "GraphicPack.h"
+#include "GraphicFrames.h"
+#include "GraphicLayers.h"
+#include "GraphicOutput.h"
+#include "GraphicShm.h"
+#include "GlyphAtlas.h"
+#include "FlushTimer.h"
+
+// Stages of a flush, as GraphicFlushTime reports them.
+#define FLUSH_MERGE 0          // LayoutFB copied into DisplayFB
+#define FLUSH_COMPOSITE 1      // layers flattened into CompositeFB
+#define FLUSH_DAMAGE 2         // tiles hashed against what was sent
+#define FLUSH_PUBLISH 3        // shared memory and the frame queue
+#define FLUSH_PACK 4           // device windows packed for the driver
+#define FLUSH_STAGES 5
 
 namespace LCD {
 
@@ -44,6 +62,8 @@ class SpecialChar;
 
 class LCDCore;
 
+class GraphicTransition;
+
 class LCDGraphicInterface {
     public:
     virtual ~LCDGraphicInterface() {}
@@ -70,40 +90,48 @@ class LCDGraphicUpdateThread;
 
 class LCDGraphic : public LCDBase, public LCDGraphicInterface {
 
-    struct _GraphicWindow {
-        int R;
-        int C;
-        int H;
-        int W;
-    } update_window_;
-
-    float tentacle_move_;
+    // Guards damage_; draws mark it, the update thread takes it.
+    QMutex damage_mutex_;
+    GraphicDamage damage_;
+    std::vector<GraphicRect> damaged_;
+    std::vector<GraphicRect> changed_;
+    std::vector<uint8_t> pack_;
+    GraphicFrames frames_;
+    GraphicLayers layers_;
+    GraphicOutput output_;
+    GlyphAtlas atlas_;
+    FlushTimer flush_times_;
 
     LCDGraphicUpdateThread *update_thread_;
     LCDGraphicWrapper *graphic_wrapper_;
     int refresh_rate_;
 
-    int shmid_display_;
-    int shmid_layout_;
-    int shmid_transition_;
+    GraphicShm shm_;
 
     bool fill_;
 
-    int transition_tick_;
-    bool transitioning_;
+    QAtomicInt transitioning_;
     std::string transition_layout_;
+    std::string warm_layout_;
+    bool warm_drawn_;
+    struct timeval warm_first_;
+    GraphicTransition *effect_;
+    struct timeval transition_start_;
+    std::vector<RGBA> from_;
+    std::vector<RGBA> to_;
+    std::vector<char> from_dirty_;
+    std::vector<char> to_dirty_;
 
-    bool is_resizing_;
+    QAtomicInt resizing_;
 
 
     void Transition();
-    void TransitionLeftRight();
-    void TransitionUpDown();
-    void TransitionTentacle();
-    void VlineFromBuffer(RGBA *dest, RGBA *src, int x, int y1, int y2);
-    void SaneCoords(int *x, int *y1, int *y2);
-    void TransitionAlphaBlend();
-    void AlphaBlendBuffer(RGBA **dest, RGBA **src1, RGBA **src2, float alpha);
+    void TransitionEnd();
+    void CompositeWindow(int row, int col, int height, int width);
+    void MergeLayout(int row, int col, int height, int width);
+    void GraphicFlush();
+    void GraphicSend(int row, int col, int height, int width);
+    void GraphicDeliver(std::vector<GraphicRect> &rects);
     int ResizeLCD(int rows, int cols);
     void ResizeBefore(int rows, int cols);
     void ResizeAfter();
@@ -114,6 +142,10 @@ class LCDGraphic : public LCDBase, public LCDGraphicInterface {
     LCDCore *visitor_;
 
     public:
+    // Guards the layer buffers and CompositeFB. Frames are published
+    // under it, so there is only ever one writer to frames_.
+    QMutex graphic_mutex_;
+
     RGBA FG_COL;
     RGBA BG_COL;
     RGBA BL_COL;
@@ -121,10 +153,17 @@ class LCDGraphic : public LCDBase, public LCDGraphicInterface {
 
 
     bool INVERTED;
+    // GRAPHIC_* format GraphicRealBlit receives its pixels in.
+    int PIXEL_FORMAT;
+    // Set by drivers that present from their own thread; they take
+    // frames with GraphicAcquireFrame instead of being blitted to.
+    bool FRAME_QUEUE;
 
     RGBA **DisplayFB;
     RGBA **LayoutFB;
     RGBA **TransitionFB;
+    // DisplayFB flattened, before the output stage.
+    RGBA *CompositeFB;
     //std::vector<std::vector<RGBA>> DisplayFB;
     //std::vector<std::vector<RGBA>> LayoutFB;
     //std::vector<std::vector<RGBA>> TransitionFB;
@@ -132,10 +171,26 @@ class LCDGraphic : public LCDBase, public LCDGraphicInterface {
     LCDGraphic(LCDCore *visitor);
     virtual ~LCDGraphic();
     void (*GraphicRealBlit) (LCDGraphic *lcd, const int row, const int col, 
-        const int height, const int width);
+        const int height, const int width, const uint8_t *data,
+        const int stride);
+    // Optional; receives every changed rectangle of a flush in one call.
+    void (*GraphicRealBlitRects) (LCDGraphic *lcd, const GraphicRect *rects,
+        int count);
     void GraphicStart();
+    const GraphicFrames::Frame *GraphicAcquireFrame() { return frames_.Acquire(); }
+    // For drivers that report on themselves: each flush timed per
+    // FLUSH_* stage, read back from the blit, and the work the pipeline
+    // has done and saved so far.
+    void GraphicTimeFlushes(bool on) { flush_times_.Enable(on); }
+    uint64_t GraphicFlushTime(int stage) { return flush_times_.Time(stage); }
+    unsigned long GraphicTilesHashed() { return damage_.Tiles(); }
+    unsigned long GraphicTilesSkipped() { return damage_.Skipped(); }
+    unsigned long GraphicRowsFlattened() { return layers_.Flattened(); }
+    unsigned long GraphicRowsCached() { return layers_.Cached(); }
+    unsigned long GraphicFramesPublished() { return frames_.Published(); }
     LCDCore *GetVisitor() { return visitor_; }
     void GraphicUpdate(int row, int col, int height, int width);
+    void GraphicMark(std::string layout, int row, int col, int height, int width);
     void GraphicDraw();
     void GraphicInit(const int rows, const int cols,
         const int yres, const int xres, const int layers, bool clear_on_layout_change = true);
@@ -150,8 +205,12 @@ class LCDGraphic : public LCDBase, public LCDGraphicInterface {
     unsigned char GraphicGray(const int row, const int col);
     unsigned char GraphicBlack(const int row, const int col);
     void GraphicRender(int layer, int row, int col, RGBA fg, RGBA bg, const char *txt, bool bold, int offset, std::string layout);
-    bool IsTransitioning() { return transitioning_; }
-    void SignalTransitionStart(std::string layout) { transitioning_ = true; transition_layout_ = layout;}
+    bool IsTransitioning() { return transitioning_.fetchAndAddOrdered(0); }
+    void SignalTransitionStart(std::string layout);
+    bool SignalWarmStart(std::string layout);
+    void SignalWarmStop();
+    bool WarmDrawn(struct timeval *when);
+    RGBA **GraphicBuffer(std::string layout);
     void SignalTransitionEnd() { 
         for(int l = 0; l < LAYERS; l++)
             for(int n = 0; n < LROWS * LCOLS; n++)
@@ -39,6 +39,8 @@
 #include "WidgetGif.h"
 #include "Widget.h"
 #include "LCDWrapper.h"
+#include "TextComposite.h"
+#include "TextPlanner.h"
 #include "RGBA.h"
 #include "debug.h"
 
@@ -49,14 +51,23 @@ extern int round(float n);
 LCDText::LCDText(LCDCore *visitor) {
     visitor_ = visitor;
     TextRealBlit = 0;
+    TextRealBlitBatch = 0;
     TextRealDefChar = 0;
+    PACKET_COST = 0;
     transition_tick_ = 0;
     transitioning_ = false;
     tentacle_move_ = 0;
     LayoutFB = 0;
     TransitionFB = 0;
+    CompositeFB = 0;
     DisplayFB = 0;
+    dirty_words_ = 0;
+    char_cache_ = new CharCache(this);
     wrapper_ = new LCDWrapper((LCDInterface *)this, 0);
+    flush_timer_ = new QTimer();
+    flush_timer_->setSingleShot(true);
+    flush_timer_->setInterval(0);
+    QObject::connect(flush_timer_, SIGNAL(timeout()), wrapper_, SLOT(TextFlush()));
     QObject::connect(visitor->GetWrapper(), SIGNAL(_LayoutChangeBefore()), 
         wrapper_, SLOT(LayoutChangeBefore()));
     QObject::connect(visitor->GetWrapper(), SIGNAL(_LayoutChangeAfter()),
@@ -65,7 +76,10 @@ LCDText::LCDText(LCDCore *visitor) {
 }
 
 LCDText::~LCDText() {
+    flush_timer_->stop();
+    delete flush_timer_;
     delete wrapper_;
+    delete char_cache_;
     if(!LayoutFB) return;
     for(int l = 0; l < LAYERS; l++) {
         free(LayoutFB[l]);
@@ -73,6 +87,7 @@ LCDText::~LCDText() {
     }
     free(LayoutFB);
     free(TransitionFB);
+    free(CompositeFB);
     free(DisplayFB);
 }
 
@@ -98,6 +113,11 @@ void LCDText::TextInit(int rows, int cols, int yres,
     }
     DisplayFB = (unsigned char *)malloc(sizeof(char) * cols * rows);;
     memset(DisplayFB, ' ', n);
+    CompositeFB = (unsigned char *)malloc(sizeof(char) * cols * rows);
+    memset(CompositeFB, ' ', n);
+    dirty_words_ = (cols + 63) / 64;
+    dirty_.assign(rows * dirty_words_, 0);
+    char_cache_->Resize(chars);
 }
 
 int LCDText::ResizeLCD(int rows, int cols) {
@@ -107,110 +127,143 @@ int LCDText::ResizeLCD(int rows, int cols) {
     }
     free(LayoutFB);
     free(TransitionFB);
+    free(CompositeFB);
     free(DisplayFB);
     TextInit(rows, cols, YRES, XRES, GOTO_COST, CHARS, CHAR0, LAYERS);
     return -1;
 }
 
 void LCDText::TextSetSpecialChars() {
-    for(int i = 0; i < (int)special_chars.size(); i++ ) {
-        if (i > CHARS) {
-            LCDError("Too many chars to process. Expected %d, got %d.", CHARS, 
-            special_chars.size());
-            break;
-        }
+    unsigned long uploads = char_cache_->Uploads();
+    std::string layout = visitor_->GetCurrentLayout();
+    for(int i = 0; i < (int)special_chars.size(); i++ )
         TextSpecialCharChanged(i);
-    } 
+    LCDInfo("LCDText: switch to <%s> uploaded %lu special chars (planned %d)",
+        layout.c_str(), char_cache_->Uploads() - uploads, 
+        char_cache_->PlannedUploads(layout));
     emit static_cast<LCDEvents *>(wrapper_)->_TextSpecialCharsSet();
 }
 
+void LCDText::TextPlanChars(std::vector<CharCache::Plan> plans) {
+    char_cache_->SetPlans(plans);
+    for(unsigned int i = 0; i < plans.size(); i++) {
+        std::string prev = plans[(i + plans.size() - 1) % plans.size()].layout;
+        LCDInfo("LCDText: <%s> -> <%s> plans %d special char uploads",
+            prev.c_str(), plans[i].layout.c_str(),
+            char_cache_->PlannedUploads(plans[i].layout));
+    }
+}
+
+// Uploads the slot only if its bitmap differs from the device's copy.
 void LCDText::TextSpecialCharChanged(int ch) {
     if( ch < 0 || ch >= CHARS || ch >= (int)special_chars.size() )
         return;
-    if(TextRealDefChar)
-        TextRealDefChar(this, ch, special_chars[ch]);
-    else
-        LCDError("LCDText: No TextRealDefChar");
-}
-
-inline char GetCell(unsigned char **buffer, int pos, int layers) {
-	char cell = ' ';
-	for(int l = layers - 1; l>=0; l--) {
-		if (buffer[l][pos] != ' ')
-			cell = buffer[l][pos];
-	}
-	return cell;
+    char_cache_->Sync(ch);
 }
 
 void LCDText::LayoutChangeBefore() {
     if(visitor_->ClearOnLayoutChange())
         TextClear();
     TextClearChars();
+    char_cache_->SelectPlan(visitor_->GetCurrentLayout());
 }
 
 void LCDText::LayoutChangeAfter() {
     TextSetSpecialChars();
 }
 
+// Mark a region as written. The display is updated by the next TextFlush,
+// which runs once the current event has been handled, so all widgets drawn
+// in one tick share a single pass over the changed cells.
 void LCDText::TextBlit(int row, int col, int height, 
     int width) {
-    int lr, lc;                        /* layout  row/col */
-    int dr, dc;                        /* display row/col */
-    int p1, p2;                        /* start/end positon of changed area */
-    int eq;                        /* counter for equal contents */
-    char fb[LROWS * LCOLS];
-
-    memset(fb, ' ', LROWS * LCOLS);
-    for(int r = row; r < LROWS && r < row + height; r++) {
-        for(int c = col; c < LCOLS && c < col + width; c++) {
-            int n = r * LCOLS + c;
-            fb[n] = GetCell(LayoutFB, n, LAYERS);
-        }
+
+    if(row < 0) { height += row; row = 0; }
+    if(col < 0) { width += col; col = 0; }
+    if(row + height > LROWS) height = LROWS - row;
+    if(col + width > LCOLS) width = LCOLS - col;
+    if(height <= 0 || width <= 0)
+        return;
+
+    for(int r = row; r < row + height; r++) {
+        uint64_t *mask = &dirty_[r * dirty_words_];
+        for(int c = col; c < col + width; c++)
+            mask[c / 64] |= (uint64_t)1 << (c % 64);
+    }
+
+    if(!flush_timer_->isActive())
+        flush_timer_->start();
+}
+
+void LCDText::TextFlush() {
+    flush_timer_->stop();
+
+    /* transitions own DisplayFB, and blit the whole layout when done */
+    if(transitioning_)
+        return;
+
+    flush_times_.Start();
+    plan_.clear();
+    for(int r = 0; r < LROWS && r < DROWS; r++)
+        TextFlushRow(r);
+    if(plan_.empty())
+        return;
+
+    for(unsigned int i = 0; i < plan_.size(); i++) {
+        TextSpan *span = &plan_[i];
+        int n = span->row * DCOLS + span->col;
+        memcpy(DisplayFB + n, CompositeFB + span->row * LCOLS + span->col,
+            span->len);
+        span->data = DisplayFB + n;
+    }
+    flush_times_.Lap(TEXT_FLUSH_COPY);
+
+    /* send to display */
+    LCDText *lcd = (LCDText *)visitor_->GetLCD();
+    if(TextRealBlitBatch) {
+        TextRealBlitBatch(lcd, &plan_[0], plan_.size());
+    } else if(TextRealBlit) {
+        for(unsigned int i = 0; i < plan_.size(); i++)
+            TextRealBlit(lcd, plan_[i].row, plan_[i].col, plan_[i].data,
+                plan_[i].len);
     }
+}
+
+void LCDText::TextFlushRow(int row) {
+    uint64_t *mask = &dirty_[row * dirty_words_];
+    unsigned char *fb = CompositeFB + row * LCOLS;
+    unsigned char *display = DisplayFB + row * DCOLS;
+    int first = -1, last = -1;
 
-    /* loop over layout rows */
-    for (lr = row; lr < LROWS && lr < row + height; lr++) {
-        /* transform layout to display row */
-        dr = lr;
-        /* sanity check */
-        if (dr < 0 || dr >= DROWS)
+    for(int w = 0; w < dirty_words_; w++) {
+        if(!mask[w])
             continue;
-        /* loop over layout cols */
-        for (lc = col; lc < LCOLS && lc < col + width; lc++) {
-            /* transform layout to display column */
-            dc = lc;
-            /* sanity check */
-            if (dc < 0 || dc >= DCOLS)
+        for(int c = w * 64; c < LCOLS && c < (w + 1) * 64; c++) {
+            if(!(mask[w] & ((uint64_t)1 << (c % 64))))
                 continue;
-            /* find start of difference */
-            if (DisplayFB[dr * DCOLS + dc] == fb[lr * LCOLS + lc])
-                continue;
-            /* find end of difference */
-            for (p1 = dc, p2 = p1, eq = 0, lc++; lc < LCOLS && lc < col + width; lc++) {
-                /* transform layout to display column */
-                dc = lc;
-                /* sanity check */
-                if (dc < 0 || dc >= DCOLS)
-                    continue;
-                if (DisplayFB[dr * DCOLS + dc] == fb[lr * LCOLS + lc]) {
-                    if (++eq > GOTO_COST)
-                        break;
-                } else {
-                    p2 = dc;
-                    eq = 0;
-                }
-            }
-            /* send to display */
-            memcpy(DisplayFB + dr * DCOLS + p1, fb + lr * LCOLS + p1, p2 - p1 + 1);
-            if (TextRealBlit)
-                TextRealBlit((LCDText *)visitor_->GetLCD(), dr, p1, 
-                    DisplayFB + dr * DCOLS + p1, p2 - p1 + 1);
+            if(first < 0)
+                first = c;
+            last = c;
         }
+        mask[w] = 0;
     }
+    if(first < 0)
+        return;
+    flush_times_.Lap(TEXT_FLUSH_PLAN);
+
+    /* re-composite the written span only */
+    TextComposite(CompositeFB, LayoutFB, LAYERS, row * LCOLS + first,
+        last - first + 1);
+    flush_times_.Lap(TEXT_FLUSH_COMPOSITE);
+    if(last >= DCOLS)
+        last = DCOLS - 1;
+
+    TextPlanRow(display, fb, row, first, last, GOTO_COST + PACKET_COST, plan_);
+    flush_times_.Lap(TEXT_FLUSH_PLAN);
 }
 
 void LCDText::CleanBuffer(unsigned char **buf) {
-    for(int l = 0; special_chars.size() > 0 && l < LAYERS; l++) {
+    for(int l = 0; TextHasChars() && l < LAYERS; l++) {
         for(int n = 0; n < LROWS * LCOLS; n++) {
             if(buf[l][n] >= CHAR0 && buf[l][n] < CHAR0 + CHARS)
                 buf[l][n] = ' ';
@@ -224,15 +277,24 @@ void LCDText::TextClear() {
     TextBlit(0, 0, LROWS, LCOLS);
 }
 
+// Drop every reference. Glyphs stay resident so the next layout can
+// pick them up again without an upload.
 void LCDText::TextClearChars() {
-    special_chars.clear();
+    char_cache_->ReleaseAll();
 }
 
 bool LCDText::TextAddChar(SpecialChar ch) {
-    if((int)special_chars.size() >= CHARS)
-        return false;
-    special_chars.push_back(ch);
-    return true;
+    return TextAcquireChar(ch, false) >= 0;
+}
+
+// Returns the slot holding ch, or -1 if all CHARS slots are taken. Shared
+// glyphs are deduplicated across widgets; private ones may be redrawn.
+int LCDText::TextAcquireChar(SpecialChar ch, bool shared) {
+    return char_cache_->Acquire(ch, shared);
+}
+
+void LCDText::TextReleaseChar(int ch) {
+    char_cache_->Release(ch);
 }
 
 void LCDText::TextGreet() {
@@ -437,7 +499,7 @@ void LCD::TextBignumsDraw(WidgetBignums *widget) {
     for(int i = 0; i < 2 && i + row < lcd->LROWS; i++) {
         for(int j = 0; j < 4 && j + col < lcd->LCOLS; j++ ) {
             fb[(row + i) * lcd->LCOLS + col + j] = 
-                (char)(n + widget->GetCh()[0] + lcd->CHAR0);
+                (char)(widget->GetCh()[n] + lcd->CHAR0);
             n++;
         }
     }
@@ -496,7 +558,7 @@ void LCD::TextGifDraw(WidgetGif *widget) {
     for(int i = 0; i < rows && i + row < (int)lcdText->LROWS; i++) {
         for(int j = 0; j < cols && j + col < (int)lcdText->LCOLS; j++ ) {
             fb[(row + i) * lcdText->LCOLS + col + j] = 
-                (char)(n + widget->GetChars()[0] + lcdText->CHAR0);
+                (char)(chars[n] + lcdText->CHAR0);
             n += 1;
         }
     }
@@ -633,7 +695,7 @@ LCDError("hahaha------------------------");
         for(int j = 0; j < width / lcdText->XRES && 
             j + col < lcdText->LCOLS; j++ ) {
             fb[(row + i) * lcdText->LCOLS + col + j] =
-                (char)(n + widget->GetChars()[0] + lcdText->CHAR0);
+                (char)(ch[n] + lcdText->CHAR0);
             n += 1;
         }
     }
@@ -716,7 +778,7 @@ void LCDText::TransitionLeftRight() {
     unsigned char layout[LROWS * LCOLS], transition[LROWS * LCOLS];
 
     // Hide last layout's special chars if new layout has special chars.
-    for(int l = 0; special_chars.size() > 0 && l < LAYERS; l++) {
+    for(int l = 0; TextHasChars() && l < LAYERS; l++) {
         for(int n = 0; n < LROWS * LCOLS; n++) {
             if(LayoutFB[l][n] >= CHAR0 && LayoutFB[l][n] < CHAR0 + CHARS)
                 LayoutFB[l][n] = ' ';
@@ -725,17 +787,8 @@ void LCDText::TransitionLeftRight() {
         }
     }
 
-    memset(layout, ' ', LROWS * LCOLS);
-    memset(transition, ' ', LROWS * LCOLS);
-
-    for(int l = LAYERS - 1; l>=0; l--) {
-        for(int n = 0; n < LROWS * LCOLS; n++) {
-            if(LayoutFB[l][n] != ' ') 
-                layout[n] = LayoutFB[l][n];
-            if(TransitionFB[l][n] != ' ')
-                transition[n] = TransitionFB[l][n];
-        }
-    }
+    TextComposite(layout, LayoutFB, LAYERS, 0, LROWS * LCOLS);
+    TextComposite(transition, TransitionFB, LAYERS, 0, LROWS * LCOLS);
 
     for(int row = 0; row < LROWS; row++) {
         int n = row * LCOLS;
@@ -782,18 +835,13 @@ void LCDText::TransitionUpDown() {
 
     // Hide last layout's special chars if new layout has special chars.
     for(int l = LAYERS - 1; l>=0; l--) {
-        for(int n = 0; special_chars.size() > 0 && n < LROWS * LCOLS; n++) {
+        for(int n = 0; TextHasChars() && n < LROWS * LCOLS; n++) {
             if(LayoutFB[l][n] >= CHAR0 && LayoutFB[l][n] < CHAR0 + CHARS)
                 LayoutFB[l][n] = ' ';
         }
     }
-    memset(layout, ' ', LROWS * LCOLS);
-    memset(transition, ' ', LROWS * LCOLS);
- 
-    for(int n = 0; n < LROWS * LCOLS; n++) {
-        layout[n] = GetCell(LayoutFB, n, LAYERS);
-    	transition[n] = GetCell(TransitionFB, n, LAYERS);
-    }
+    TextComposite(layout, LayoutFB, LAYERS, 0, LROWS * LCOLS);
+    TextComposite(transition, TransitionFB, LAYERS, 0, LROWS * LCOLS);
 
     if(direction == TRANSITION_UP) {
         top = layout;
@@ -875,25 +923,16 @@ void LCDText::TransitionTentacle() {
     double rate = (LCOLS - transition_tick_) / (double)LCOLS;
     unsigned char layout[LCOLS * LROWS];
 
-    memset(DisplayFB, (int)' ', LCOLS * LROWS);
-    memset(layout, (int)' ', LCOLS * LROWS);
-
     // Hide last layout's special chars if new layout has special chars.
     for(int l = LAYERS - 1; l>=0; l--) {
-        for(int n = 0; special_chars.size() > 0 && n < LROWS * LCOLS; n++) {
+        for(int n = 0; TextHasChars() && n < LROWS * LCOLS; n++) {
             if(LayoutFB[l][n] >= CHAR0 && LayoutFB[l][n] < CHAR0 + CHARS)
                 LayoutFB[l][n] = ' ';
         }
     }
 
-    for(int l = LAYERS - 1; l>=0; l--) {
-        for(int n = 0; n < LCOLS * LROWS; n++) {
-            if(LayoutFB[l][n] != ' ')
-                layout[n] = LayoutFB[l][n];
-            if(TransitionFB[l][n] != ' ')
-                DisplayFB[n] = TransitionFB[l][n];
-        }
-    }
+    TextComposite(layout, LayoutFB, LAYERS, 0, LCOLS * LROWS);
+    TextComposite(DisplayFB, TransitionFB, LAYERS, 0, LCOLS * LROWS);
 
     for(int i = 0; i < LCOLS; i++) {
 
@@ -26,9 +26,20 @@
 
 #include <vector>
 #include <string>
+#include <stdint.h>
+#include <QTimer>
 #include "LCDBase.h"
 #include "SpecialChar.h"
+#include "CharCache.h"
 #include "LCDWrapper.h"
+#include "TextPlanner.h"
+#include "FlushTimer.h"
+
+// Stages of a flush, as TextFlushTime reports them.
+#define TEXT_FLUSH_COMPOSITE 0 // layers flattened into CompositeFB
+#define TEXT_FLUSH_PLAN 1      // changed cells found and planned as spans
+#define TEXT_FLUSH_COPY 2      // spans copied into DisplayFB
+#define TEXT_FLUSH_STAGES 3
 
 namespace LCD {
 
@@ -46,16 +57,28 @@ class LCDGraphic;
 class LCDText: public LCDBase, public LCDInterface {
     LCDWrapper *wrapper_;
     std::string transition_layout_;
+    QTimer *flush_timer_;
+    // Cells written since the last flush, one bit per column.
+    std::vector<uint64_t> dirty_;
+    int dirty_words_;
+    std::vector<TextSpan> plan_;
+    FlushTimer flush_times_;
+    CharCache *char_cache_;
     public:
     unsigned char **LayoutFB;
     unsigned char **TransitionFB;
+    unsigned char *CompositeFB;
     unsigned char *DisplayFB;
     void (*TextRealBlit) (LCDText *obj, int row, int col,
         unsigned char *data, int len);
+    // Optional; receives every span of a flush in one call.
+    void (*TextRealBlitBatch) (LCDText *obj, const TextSpan *spans,
+        int count);
     void (*TextRealDefChar) (LCDText *obj, const int ascii, 
         SpecialChar matrix);
     std::vector<SpecialChar> special_chars;
     int GOTO_COST;
+    int PACKET_COST;
     int CHARS;
     int CHAR0;
     int transition_tick_;
@@ -69,11 +92,22 @@ class LCDText: public LCDBase, public LCDInterface {
         int layers);
     void TextBlit(int row, int col, int  height, 
         int width);
+    void TextFlushRow(int row);
     int ResizeLCD(int rows, int cols);
     void CleanBuffer(unsigned char **buf);
     void TextClear();
     void TextClearChars();
     bool TextAddChar(SpecialChar ch);
+    int TextAcquireChar(SpecialChar ch, bool shared = true);
+    void TextReleaseChar(int ch);
+    bool TextHasChars() { return char_cache_->InUse() > 0; }
+    void TextInvalidateChars() { char_cache_->Invalidate(); }
+    unsigned long TextCharUploads() { return char_cache_->Uploads(); }
+    // For drivers that report on themselves: each flush timed per
+    // TEXT_FLUSH_* stage, read back from the blit.
+    void TextTimeFlushes(bool on) { flush_times_.Enable(on); }
+    uint64_t TextFlushTime(int stage) { return flush_times_.Time(stage); }
+    void TextPlanChars(std::vector<CharCache::Plan> plans);
     void TextGreet();
     void Transition();
     void TransitionLeftRight();
@@ -85,6 +119,7 @@ class LCDText: public LCDBase, public LCDInterface {
     void SignalTransitionStart(std::string layout) { 
         CleanBuffer(LayoutFB);
         TextBlit(0, 0, LROWS, LCOLS);
+        TextFlush();
         transitioning_ = true; transition_layout_ = layout;
     }
     void SignalTransitionEnd() { }
@@ -95,10 +130,13 @@ class LCDText: public LCDBase, public LCDInterface {
     void LayoutChangeBefore();
     void LayoutChangeAfter();
     void TextSpecialCharChanged(int ch);
+    void TextFlush();
     void ChangeLayout() {}
+    void WarmLayout() {}
     void LayoutTransition() {}
     void TransitionFinished() {}
     void KeypadEvent(int k) {}
+    void PressureEvent(int r) {}
 
 };
 
@@ -39,10 +39,13 @@ class LCDInterface {
     virtual void LayoutChangeBefore() = 0;
     virtual void LayoutChangeAfter() = 0;
     virtual void TextSpecialCharChanged(int i) = 0;
+    virtual void TextFlush() = 0;
     virtual void ChangeLayout() = 0;
+    virtual void WarmLayout() = 0;
     virtual void LayoutTransition() = 0;
     virtual void TransitionFinished() = 0;
     virtual void KeypadEvent(const int) = 0;
+    virtual void PressureEvent(const int) = 0;
 };
 
 class LCDEvents {
@@ -58,6 +61,7 @@ class LCDEvents {
     virtual void _DisplayDisconnectedAfter() = 0;
     virtual void _DisplayConnected() = 0;
     virtual void _KeypadEvent(const int) = 0;
+    virtual void _PressureEvent(const int) = 0;
     virtual void _ResizeLCD(int rows, int cols, int old_rows, int old_cols) = 0;
     virtual void _ResizeBefore(int rows, int cols) = 0;
     virtual void _ResizeAfter() = 0;
@@ -75,10 +79,13 @@ class LCDWrapper : public LCDInterface, public LCDEvents {
     void LayoutChangeAfter() { wrappedObject->LayoutChangeAfter(); };
     void TextSpecialCharChanged(int i) { 
         wrappedObject->TextSpecialCharChanged(i); };
+    void TextFlush() { wrappedObject->TextFlush(); }
     void ChangeLayout() { wrappedObject->ChangeLayout(); }
+    void WarmLayout() { wrappedObject->WarmLayout(); }
     void LayoutTransition() { wrappedObject->LayoutTransition(); }
     void TransitionFinished() { wrappedObject->TransitionFinished(); }
     void KeypadEvent(const int k) { wrappedObject->KeypadEvent(k); }
+    void PressureEvent(const int r) { wrappedObject->PressureEvent(r); }
 
     signals:
     void _TextSpecialCharsSet();
@@ -90,6 +97,7 @@ class LCDWrapper : public LCDInterface, public LCDEvents {
     void _DisplayDisconnectedAfter();
     void _DisplayConnected();
     void _KeypadEvent(const int key);
+    void _PressureEvent(const int resource);
     void _ResizeLCD(int rows, int cols, int old_rows, int old_cols);
     void _ResizeBefore(int rows, int cols);
     void _ResizeAfter();
@@ -0,0 +1,155 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "NullStats.h"
+#include "debug.h"
+
+using namespace LCD;
+
+static uint64_t Elapsed(const struct timeval &from, const struct timeval &to) {
+    return (uint64_t)(to.tv_sec - from.tv_sec) * 1000000 +
+        to.tv_usec - from.tv_usec;
+}
+
+NullStats::NullStats(std::string name, std::string unit, int baud,
+    int report) : name_(name), unit_(unit), baud_(baud), report_(report),
+    frames_(0), units_(0), bytes_(0) {
+    copy_.total = copy_.max = copy_.frames = 0;
+    wire_.total = wire_.max = wire_.frames = 0;
+    gettimeofday(&start_, NULL);
+    last_report_ = frame_start_ = copy_end_ = start_;
+}
+
+void NullStats::Add(Stage &stage, uint64_t us) {
+    stage.total += us;
+    stage.frames++;
+    if(us > stage.max)
+        stage.max = us;
+}
+
+// Index of name, added at the end if it is new.
+int NullStats::Find(std::vector<std::string> &names, const char *name) {
+    for(unsigned int i = 0; i < names.size(); i++)
+        if(names[i] == name)
+            return i;
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+// Called with mutex_ held.
+void NullStats::Log(const struct timeval &now) {
+    uint64_t us = Elapsed(start_, now);
+    double secs = us ? us / 1000000.0 : 1.0;
+    uint64_t copies = copy_.frames ? copy_.frames : 1;
+    uint64_t wires = wire_.frames ? wire_.frames : 1;
+    LCDInfo("%s: %llu frames (%.1f/s), %llu %s, %llu bytes (%.0f/s)",
+        name_.c_str(), (unsigned long long)frames_, frames_ / secs,
+        (unsigned long long)units_, unit_.c_str(),
+        (unsigned long long)bytes_, bytes_ / secs);
+    LCDInfo("%s: copy %llu/%llu us, wire %llu/%llu us (mean/max per write)",
+        name_.c_str(),
+        (unsigned long long)(copy_.total / copies),
+        (unsigned long long)copy_.max,
+        (unsigned long long)(wire_.total / wires),
+        (unsigned long long)wire_.max);
+
+    std::string line;
+    char buf[128];
+    for(unsigned int i = 0; i < stages_.size(); i++) {
+        const Stage &stage = stages_[i];
+        uint64_t n = stage.frames ? stage.frames : 1;
+        snprintf(buf, sizeof(buf), "%s%s %llu/%llu", i ? ", " : "",
+            stage_names_[i].c_str(), (unsigned long long)(stage.total / n),
+            (unsigned long long)stage.max);
+        line += buf;
+    }
+    if(!line.empty())
+        LCDInfo("%s: %s us (mean/max per frame)", name_.c_str(),
+            line.c_str());
+
+    line.clear();
+    for(unsigned int i = 0; i < counters_.size(); i++) {
+        snprintf(buf, sizeof(buf), "%s%s %lu", i ? ", " : "",
+            counter_names_[i].c_str(), counters_[i]);
+        line += buf;
+    }
+    if(!line.empty())
+        LCDInfo("%s: %s", name_.c_str(), line.c_str());
+    last_report_ = now;
+}
+
+void NullStats::Begin() {
+    mutex_.lock();
+    gettimeofday(&frame_start_, NULL);
+}
+
+// The write is in memory; account for it and send it down the wire.
+void NullStats::Wire(int units, int bytes, bool frame) {
+    gettimeofday(&copy_end_, NULL);
+    Add(copy_, Elapsed(frame_start_, copy_end_));
+    if(frame)
+        frames_++;
+    units_ += units;
+    bytes_ += bytes;
+    if(baud_ > 0) {
+        uint64_t us = (uint64_t)bytes * 10 * 1000000 / baud_;
+        if(us > 0)
+            usleep(us);
+    }
+}
+
+// Time the display spent in one of its stages on this frame.
+void NullStats::Pipeline(const char *stage, uint64_t us) {
+    unsigned int i = Find(stage_names_, stage);
+    if(i == stages_.size()) {
+        Stage blank = { 0, 0, 0 };
+        stages_.push_back(blank);
+    }
+    Add(stages_[i], us);
+}
+
+// Running value of one of the display's counters.
+void NullStats::Counter(const char *counter, unsigned long value) {
+    unsigned int i = Find(counter_names_, counter);
+    if(i == counters_.size())
+        counters_.push_back(0);
+    counters_[i] = value;
+}
+
+void NullStats::End() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    Add(wire_, Elapsed(copy_end_, now));
+    if(report_ > 0 && Elapsed(last_report_, now) >= (uint64_t)report_ * 1000)
+        Log(now);
+    mutex_.unlock();
+}
+
+void NullStats::Flush() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    mutex_.lock();
+    Log(now);
+    mutex_.unlock();
+}
@@ -0,0 +1,91 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __NULL_STATS_H__
+#define __NULL_STATS_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <QMutex>
+
+namespace LCD {
+
+/*
+ * Throughput counters for the null drivers. A driver brackets each flush
+ * it receives with Begin and End: Begin starts the copy stage, Wire ends
+ * it and, given a baud rate, holds the caller for as long as the bytes
+ * would take on an 8N1 serial line, as a blocking write to a real port
+ * would. Writes that aren't a whole frame, such as a glyph upload, pass
+ * frame false: they count as traffic but not towards frames/s. Between
+ * the two the driver passes on what the display measured
+ * of the same frame: the time of each stage of its pipeline and the
+ * running values of its counters, which are logged alongside. Report
+ * logs totals and per-stage latency every report_ ms, or only from
+ * Flush when report_ is 0.
+ */
+class NullStats {
+
+    typedef struct _Stage {
+        uint64_t total;
+        uint64_t max;
+        uint64_t frames;
+    } Stage;
+
+    std::string name_;
+    std::string unit_;
+    int baud_;
+    int report_;
+    QMutex mutex_;
+
+    uint64_t frames_;
+    uint64_t units_;
+    uint64_t bytes_;
+    Stage copy_;
+    Stage wire_;
+    // The display's, in the order the driver first passed them.
+    std::vector<std::string> stage_names_;
+    std::vector<Stage> stages_;
+    std::vector<std::string> counter_names_;
+    std::vector<unsigned long> counters_;
+    struct timeval start_;
+    struct timeval last_report_;
+    struct timeval frame_start_;
+    struct timeval copy_end_;
+
+    void Add(Stage &stage, uint64_t us);
+    static int Find(std::vector<std::string> &names, const char *name);
+    void Log(const struct timeval &now);
+
+    public:
+    NullStats(std::string name, std::string unit, int baud, int report);
+    void Begin();
+    void Wire(int units, int bytes, bool frame = true);
+    void Pipeline(const char *stage, uint64_t us);
+    void Counter(const char *counter, unsigned long value);
+    void End();
+    void Flush();
+};
+
+}; // End namespace
+
+#endif
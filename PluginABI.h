@@ -0,0 +1,95 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PLUGIN_ABI_H__
+#define __PLUGIN_ABI_H__
+
+/*
+ * C interface for data source plugins loaded at runtime.
+ *
+ * A plugin is a shared object in the plugins directory exporting
+ * LCD_PLUGIN_ENTRY. The host calls it with its own ABI version and the
+ * plugin returns a descriptor, or NULL if it can't serve that host.
+ *
+ * Sources are sampled in batches: one sample() call fills every row and
+ * column of the table, and expressions read the table afterwards. The
+ * host never calls into the plugin per value.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_PLUGIN_ABI_VERSION 1
+#define LCD_PLUGIN_ENTRY "lcd_plugin_entry"
+
+typedef enum {
+    LCD_COLUMN_INT = 0,
+    LCD_COLUMN_DOUBLE = 1,
+    LCD_COLUMN_STRING = 2
+} lcd_column_type;
+
+typedef struct {
+    const char *name;
+    int type;                   /* lcd_column_type */
+} lcd_column;
+
+/* Host owned output table. Rows are addressed by index, and may carry a
+   key (a device, cgroup or pid name) so expressions can look them up. */
+typedef struct lcd_table lcd_table;
+
+struct lcd_table {
+    void *host;
+    int (*set_rows)(lcd_table *table, int rows);
+    void (*set_key)(lcd_table *table, int row, const char *key);
+    void (*set_int)(lcd_table *table, int row, int col, int64_t value);
+    void (*set_double)(lcd_table *table, int row, int col, double value);
+    void (*set_string)(lcd_table *table, int row, int col,
+        const char *value, size_t len);
+};
+
+typedef struct {
+    uint32_t abi_version;       /* LCD_PLUGIN_ABI_VERSION */
+    uint32_t struct_size;       /* sizeof(lcd_plugin) */
+    const char *name;
+    int interval;               /* minimum msec between samples */
+    const lcd_column *columns;
+    int ncolumns;
+
+    /* config is the plugin's JSON section, serialized, or NULL */
+    void *(*open)(const char *config);
+    /* now is in msec; return 0 on success, -1 to keep the last table.
+       The table starts over at set_rows: cells left unset read as 0 or
+       empty, not as the previous sample's values */
+    int (*sample)(void *ctx, uint64_t now, lcd_table *out);
+    void (*close)(void *ctx);
+} lcd_plugin;
+
+typedef const lcd_plugin *(*lcd_plugin_entry_fn)(uint32_t host_abi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,327 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <algorithm>
+#include <json/json.h>
+
+#include "PluginCgroup.h"
+#include "debug.h"
+
+#define CGROUP_SORT_CPU 0
+#define CGROUP_SORT_MEMORY 1
+
+using namespace LCD;
+
+static const lcd_column cgroup_columns[] = {
+    { "cpu", LCD_COLUMN_DOUBLE },           /* percent of one cpu */
+    { "cpu_usec", LCD_COLUMN_INT },
+    { "memory", LCD_COLUMN_INT },           /* bytes */
+    { "anon", LCD_COLUMN_INT },
+    { "file", LCD_COLUMN_INT },
+    { "io_read", LCD_COLUMN_DOUBLE },       /* bytes per second */
+    { "io_write", LCD_COLUMN_DOUBLE }
+};
+
+static lcd_plugin cgroup_plugin = {
+    LCD_PLUGIN_ABI_VERSION,
+    sizeof(lcd_plugin),
+    "cgroup",
+    1000,
+    cgroup_columns,
+    sizeof(cgroup_columns) / sizeof(cgroup_columns[0]),
+    NULL,
+    NULL,
+    NULL
+};
+
+const lcd_plugin *PluginCgroup::Descriptor() {
+    cgroup_plugin.open = PluginOpen;
+    cgroup_plugin.sample = PluginSample;
+    cgroup_plugin.close = PluginClose;
+    return &cgroup_plugin;
+}
+
+void *PluginCgroup::PluginOpen(const char *config) {
+    return new PluginCgroup(config);
+}
+
+int PluginCgroup::PluginSample(void *ctx, uint64_t now, lcd_table *out) {
+    return ((PluginCgroup *)ctx)->Sample(now, out);
+}
+
+void PluginCgroup::PluginClose(void *ctx) {
+    delete (PluginCgroup *)ctx;
+}
+
+// config: { "root": "/sys/fs/cgroup", "subtrees": ["system.slice"],
+//           "top": 10, "sort": "cpu" | "memory", "rescan": 10000 }
+PluginCgroup::PluginCgroup(const char *config) {
+    Json::Reader reader;
+    Json::Value cfg;
+
+    if(config)
+        reader.parse(config, cfg);
+
+    root_ = cfg.get("root", "/sys/fs/cgroup").asString();
+    top_ = cfg.get("top", 0).asInt();
+    sort_ = cfg.get("sort", "cpu").asString() == "memory" ? 
+        CGROUP_SORT_MEMORY : CGROUP_SORT_CPU;
+    rescan_ = cfg.get("rescan", 10000).asInt();
+
+    Json::Value subtrees = cfg.get("subtrees", Json::Value());
+    for(unsigned int i = 0; subtrees.isArray() && i < subtrees.size(); i++)
+        subtrees_.push_back(subtrees[i].asString());
+    if(subtrees_.empty())
+        subtrees_.push_back("");
+
+    last_sample_ = 0;
+    last_scan_ = 0;
+}
+
+PluginCgroup::~PluginCgroup() {
+    while(!groups_.empty())
+        Remove(groups_.begin());
+}
+
+static int OpenStat(std::string path) {
+    return open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+void PluginCgroup::Add(std::string rel) {
+    std::string dir = root_ + (rel == "" ? "" : "/" + rel);
+    Cgroup *group = new Cgroup();
+
+    group->name = rel == "" ? "/" : rel;
+    group->cpu_fd = OpenStat(dir + "/cpu.stat");
+    group->mem_fd = OpenStat(dir + "/memory.current");
+    group->memstat_fd = OpenStat(dir + "/memory.stat");
+    group->io_fd = OpenStat(dir + "/io.stat");
+    group->seen = true;
+    group->primed = false;
+
+    if(group->cpu_fd < 0 && group->mem_fd < 0) {
+        /* controllers not enabled here */
+        delete group;
+        return;
+    }
+    groups_[rel] = group;
+}
+
+void PluginCgroup::Remove(std::map<std::string, Cgroup *>::iterator it) {
+    Cgroup *group = it->second;
+    if(group->cpu_fd >= 0) close(group->cpu_fd);
+    if(group->mem_fd >= 0) close(group->mem_fd);
+    if(group->memstat_fd >= 0) close(group->memstat_fd);
+    if(group->io_fd >= 0) close(group->io_fd);
+    delete group;
+    groups_.erase(it);
+}
+
+void PluginCgroup::Walk(std::string rel) {
+    std::map<std::string, Cgroup *>::iterator it = groups_.find(rel);
+    if(it == groups_.end())
+        Add(rel);
+    else
+        it->second->seen = true;
+
+    std::string dir = root_ + (rel == "" ? "" : "/" + rel);
+    DIR *d = opendir(dir.c_str());
+    if(!d)
+        return;
+
+    struct dirent *entry;
+    while((entry = readdir(d)) != NULL) {
+        if(entry->d_type != DT_DIR || entry->d_name[0] == '.')
+            continue;
+        Walk(rel == "" ? entry->d_name : rel + "/" + entry->d_name);
+    }
+    closedir(d);
+}
+
+// Pick up new cgroups and drop removed ones. Existing cgroups keep their
+// fds and previous counters.
+void PluginCgroup::Scan() {
+    for(std::map<std::string, Cgroup *>::iterator it = groups_.begin();
+        it != groups_.end(); it++)
+        it->second->seen = false;
+
+    for(unsigned int i = 0; i < subtrees_.size(); i++)
+        Walk(subtrees_[i]);
+
+    for(std::map<std::string, Cgroup *>::iterator it = groups_.begin();
+        it != groups_.end(); ) {
+        std::map<std::string, Cgroup *>::iterator next = it;
+        next++;
+        if(!it->second->seen)
+            Remove(it);
+        it = next;
+    }
+}
+
+static int ReadFd(int fd, char *buffer, int size) {
+    if(fd < 0)
+        return -1;
+    int len = pread(fd, buffer, size - 1, 0);
+    if(len < 0)
+        return -1;
+    buffer[len] = '\0';
+    return len;
+}
+
+/* as ReadFd, growing buffer until the whole file fits */
+static int ReadFdAll(int fd, std::vector<char> &buffer) {
+    if(buffer.size() < 4096)
+        buffer.resize(4096);
+    for(;;) {
+        int len = ReadFd(fd, &buffer[0], buffer.size());
+        if(len < (int)buffer.size() - 1)
+            return len;
+        buffer.resize(buffer.size() * 2);
+    }
+}
+
+/* find "key value" in a flat keyed file, def if it isn't there */
+static int64_t KeyedValue(const char *buffer, const char *key,
+    int64_t def = 0) {
+    size_t klen = strlen(key);
+    const char *p = buffer;
+    while(p && *p) {
+        if(strncmp(p, key, klen) == 0 && p[klen] == ' ')
+            return strtoll(p + klen + 1, NULL, 10);
+        if((p = strchr(p, '\n')) != NULL)
+            p++;
+    }
+    return def;
+}
+
+/* per second change of a counter; one that went backwards was reset
+   (or lost a device from its sum) and counts as no change */
+static double Rate(uint64_t now, uint64_t before, double dt) {
+    return now < before ? 0.0 : (now - before) / dt;
+}
+
+int PluginCgroup::ReadGroup(Cgroup *group, double dt) {
+    char buffer[4096];
+    uint64_t usage = group->usage_usec;
+    uint64_t rbytes = 0, wbytes = 0;
+
+    int len = ReadFd(group->cpu_fd, buffer, sizeof(buffer));
+    if(len < 0 && group->cpu_fd >= 0 && errno == ENODEV)
+        return -1;      /* cgroup was removed */
+    if(len > 0)
+        usage = KeyedValue(buffer, "usage_usec", usage);
+
+    if(ReadFd(group->mem_fd, buffer, sizeof(buffer)) > 0)
+        group->memory = strtoll(buffer, NULL, 10);
+
+    if(ReadFd(group->memstat_fd, buffer, sizeof(buffer)) > 0) {
+        group->anon = KeyedValue(buffer, "anon");
+        group->file = KeyedValue(buffer, "file");
+    }
+
+    /* "8:0 rbytes=1 wbytes=2 rios=3 ..." per device */
+    if(ReadFdAll(group->io_fd, io_buffer_) > 0) {
+        char *io = &io_buffer_[0];
+        for(char *p = io; (p = strstr(p, "rbytes=")) != NULL; p++)
+            rbytes += strtoull(p + 7, NULL, 10);
+        for(char *p = io; (p = strstr(p, "wbytes=")) != NULL; p++)
+            wbytes += strtoull(p + 7, NULL, 10);
+    }
+
+    if(group->primed && dt > 0) {
+        group->cpu = Rate(usage, group->usage_usec, dt) / 10000.0;
+        group->read_rate = Rate(rbytes, group->rbytes, dt);
+        group->write_rate = Rate(wbytes, group->wbytes, dt);
+    } else {
+        group->cpu = group->read_rate = group->write_rate = 0.0;
+    }
+    group->usage_usec = usage;
+    group->rbytes = rbytes;
+    group->wbytes = wbytes;
+    group->primed = true;
+    return 0;
+}
+
+struct CgroupOrder {
+    int sort;
+    CgroupOrder(int s) : sort(s) {}
+    template <class T> bool operator()(const T *a, const T *b) const {
+        if(sort == CGROUP_SORT_MEMORY)
+            return a->memory > b->memory;
+        return a->cpu > b->cpu;
+    }
+};
+
+int PluginCgroup::Sample(uint64_t now, lcd_table *out) {
+    if(last_scan_ == 0 || (rescan_ >= 0 && now - last_scan_ >= (uint64_t)rescan_)) {
+        Scan();
+        last_scan_ = now;
+    }
+
+    double dt = last_sample_ ? (now - last_sample_) / 1000.0 : 0.0;
+    last_sample_ = now;
+
+    /* a removed cgroup is dropped now, not left to the rescan: one
+       recreated at the same path would otherwise keep the dead fds */
+    order_.clear();
+    for(std::map<std::string, Cgroup *>::iterator it = groups_.begin();
+        it != groups_.end(); ) {
+        std::map<std::string, Cgroup *>::iterator next = it;
+        next++;
+        if(ReadGroup(it->second, dt) == 0) {
+            order_.push_back(it->second);
+        } else {
+            Remove(it);
+            last_scan_ = 0;
+        }
+        it = next;
+    }
+
+    int rows = order_.size();
+    if(top_ > 0 && top_ < rows) {
+        std::partial_sort(order_.begin(), order_.begin() + top_, order_.end(),
+            CgroupOrder(sort_));
+        rows = top_;
+    } else {
+        std::sort(order_.begin(), order_.end(), CgroupOrder(sort_));
+    }
+
+    out->set_rows(out, rows);
+    for(int i = 0; i < rows; i++) {
+        Cgroup *group = order_[i];
+        out->set_key(out, i, group->name.c_str());
+        out->set_double(out, i, 0, group->cpu);
+        out->set_int(out, i, 1, group->usage_usec);
+        out->set_int(out, i, 2, group->memory);
+        out->set_int(out, i, 3, group->anon);
+        out->set_int(out, i, 4, group->file);
+        out->set_double(out, i, 5, group->read_rate);
+        out->set_double(out, i, 6, group->write_rate);
+    }
+    return 0;
+}
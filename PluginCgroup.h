@@ -0,0 +1,91 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PLUGIN_CGROUP_H__
+#define __PLUGIN_CGROUP_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "PluginABI.h"
+
+namespace LCD {
+
+/*
+ * cgroup v2 resource source. Reads cpu.stat, memory.current, memory.stat
+ * and io.stat of every cgroup below the configured subtrees through fds
+ * kept open between samples; the tree is only rescanned every "rescan"
+ * msec. Registered with PluginLoader as source "cgroup".
+ */
+class PluginCgroup {
+
+    typedef struct _Cgroup {
+        std::string name;
+        int cpu_fd;
+        int mem_fd;
+        int memstat_fd;
+        int io_fd;
+        bool seen;
+        bool primed;
+        uint64_t usage_usec;
+        uint64_t rbytes;
+        uint64_t wbytes;
+        int64_t memory;
+        int64_t anon;
+        int64_t file;
+        double cpu;
+        double read_rate;
+        double write_rate;
+    } Cgroup;
+
+    std::string root_;
+    std::vector<std::string> subtrees_;
+    int top_;
+    int sort_;
+    int rescan_;
+    uint64_t last_sample_;
+    uint64_t last_scan_;
+    std::map<std::string, Cgroup *> groups_;
+    std::vector<Cgroup *> order_;
+    // io.stat has a line per device; grown to fit the longest seen.
+    std::vector<char> io_buffer_;
+
+    void Scan();
+    void Walk(std::string rel);
+    void Add(std::string rel);
+    void Remove(std::map<std::string, Cgroup *>::iterator it);
+    int ReadGroup(Cgroup *group, double dt);
+
+    static void *PluginOpen(const char *config);
+    static int PluginSample(void *ctx, uint64_t now, lcd_table *out);
+    static void PluginClose(void *ctx);
+
+    public:
+    PluginCgroup(const char *config);
+    ~PluginCgroup();
+    int Sample(uint64_t now, lcd_table *out);
+    static const lcd_plugin *Descriptor();
+};
+
+}; // End namespace
+
+#endif
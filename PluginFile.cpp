@@ -23,6 +23,13 @@
 
 #include <stdio.h>
 #include <cstring>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <sys/inotify.h>
 
 #include "debug.h"
 #include "PluginFile.h"
@@ -31,42 +38,262 @@
 #include <dmalloc.h>
 #endif
 
+/* readline never returned more than this many chars per line */
+#define LINE_SIZE 80
+
+/* procfs and sysfs never report modifications, reread them every 10 msec */
+#define PSEUDO_AGE 10
+#define PROC_MAGIC 0x9fa0
+#define SYSFS_MAGIC 0x62656572
+
 using namespace LCD;
 
+PluginFile::PluginFile() {
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0)
+        LCDError("readline: inotify_init failed, falling back to mtime: %s",
+            strerror(errno));
+}
+
+PluginFile::~PluginFile() {
+    for (std::map<std::string, FileCache>::iterator it = cache_.begin();
+        it != cache_.end(); it++) {
+        if (it->second.fd >= 0)
+            close(it->second.fd);
+    }
+    if (inotify_fd_ >= 0)
+        close(inotify_fd_);
+}
+
+static std::string Dirname(std::string path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos)
+        return ".";
+    if (slash == 0)
+        return "/";
+    return path.substr(0, slash);
+}
+
+static std::string Basename(std::string path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos)
+        return path;
+    return path.substr(slash + 1);
+}
+
+void PluginFile::Watch(int wd, std::string path) {
+    if (wd >= 0)
+        watches_[wd].push_back(path);
+}
+
+/* forget path under wd, and the watch itself once nothing uses it */
+void PluginFile::Unwatch(int wd, std::string path) {
+    std::map<int, std::vector<std::string> >::iterator w = watches_.find(wd);
+    if (w == watches_.end())
+        return;
+    std::vector<std::string> &paths = w->second;
+    for (std::vector<std::string>::iterator p = paths.begin();
+        p != paths.end(); p++) {
+        if (*p == path) {
+            paths.erase(p);
+            break;
+        }
+    }
+    if (paths.empty()) {
+        watches_.erase(w);
+        if (inotify_fd_ >= 0)
+            inotify_rm_watch(inotify_fd_, wd);
+    }
+}
+
+/* drain pending inotify events and mark the affected files stale */
+void PluginFile::ReadEvents() {
+    char buffer[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+
+    if (inotify_fd_ < 0)
+        return;
+
+    while ((len = read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + len;
+            p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+            struct inotify_event *event = (struct inotify_event *)p;
+            std::map<int, std::vector<std::string> >::iterator w =
+                watches_.find(event->wd);
+            if (w == watches_.end())
+                continue;
+            /* copied, dropping a file edits the list */
+            std::vector<std::string> paths = w->second;
+            for (unsigned int i = 0; i < paths.size(); i++) {
+                if (event->len > 0) {
+                    /* directory event; the name was unlinked or a new
+                       file landed on it */
+                    if (Basename(paths[i]) == event->name)
+                        DropFile(paths[i]);
+                } else if (event->mask & IN_IGNORED) {
+                    DropFile(paths[i]);
+                } else if (event->mask &
+                    (IN_DELETE_SELF | IN_MOVE_SELF | IN_ATTRIB)) {
+                    /* file was replaced or unlinked (our fd keeps the inode
+                       alive, so only its link count drop shows, as
+                       IN_ATTRIB); reopen it by path on next access */
+                    DropFile(paths[i]);
+                } else if (event->mask & (IN_MODIFY | IN_CLOSE_WRITE)) {
+                    std::map<std::string, FileCache>::iterator f =
+                        cache_.find(paths[i]);
+                    if (f != cache_.end())
+                        f->second.stale = true;
+                }
+            }
+        }
+    }
+}
+
+void PluginFile::DropFile(std::string path) {
+    std::map<std::string, FileCache>::iterator it = cache_.find(path);
+    if (it == cache_.end())
+        return;
+    Unwatch(it->second.wd, path);
+    Unwatch(it->second.dir_wd, path);
+    if (it->second.fd >= 0)
+        close(it->second.fd);
+    cache_.erase(it);
+}
+
+/* (re)read the whole file through its open fd and index line starts */
+int PluginFile::LoadFile(FileCache *file) {
+    char buffer[4096];
+    ssize_t len;
+    off_t pos = 0;
+
+    file->data.clear();
+    while ((len = pread(file->fd, buffer, sizeof(buffer), pos)) > 0) {
+        file->data.append(buffer, len);
+        pos += len;
+    }
+    if (len < 0)
+        return -1;
+
+    file->lines.clear();
+    file->lines.push_back(0);
+    for (size_t i = 0; i < file->data.size(); i++) {
+        if (file->data[i] == '\n' && i + 1 < file->data.size())
+            file->lines.push_back(i + 1);
+    }
+    if (file->data.empty())
+        file->lines.clear();
+
+    gettimeofday(&file->timestamp, NULL);
+    file->stale = false;
+    return 0;
+}
+
+PluginFile::FileCache *PluginFile::Fetch(std::string path) {
+    struct stat st;
+    struct timeval now;
+
+    ReadEvents();
+
+    std::map<std::string, FileCache>::iterator it = cache_.find(path);
+    if (it == cache_.end()) {
+        FileCache file;
+        struct statfs sfs;
+
+        file.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file.fd < 0)
+            return NULL;
+        file.wd = -1;
+        file.dir_wd = -1;
+        file.stale = true;
+        file.pseudo = fstatfs(file.fd, &sfs) == 0 &&
+            (sfs.f_type == PROC_MAGIC || sfs.f_type == SYSFS_MAGIC);
+        file.mtime = 0;
+        file.size = 0;
+        file.dev = 0;
+        file.ino = 0;
+        if (fstat(file.fd, &st) == 0) {
+            file.dev = st.st_dev;
+            file.ino = st.st_ino;
+        }
+        if (!file.pseudo && inotify_fd_ >= 0) {
+            /* the directory sees a rename, create or unlink on the
+               path, which the open file itself never does */
+            file.wd = inotify_add_watch(inotify_fd_, path.c_str(),
+                IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF |
+                IN_ATTRIB);
+            file.dir_wd = inotify_add_watch(inotify_fd_,
+                Dirname(path).c_str(), IN_MOVED_TO | IN_CREATE | IN_DELETE);
+            if (file.wd < 0 || file.dir_wd < 0) {
+                if (file.wd >= 0 && !watches_.count(file.wd))
+                    inotify_rm_watch(inotify_fd_, file.wd);
+                if (file.dir_wd >= 0 && !watches_.count(file.dir_wd))
+                    inotify_rm_watch(inotify_fd_, file.dir_wd);
+                file.wd = file.dir_wd = -1;
+            }
+            Watch(file.wd, path);
+            Watch(file.dir_wd, path);
+        }
+        it = cache_.insert(std::make_pair(path, file)).first;
+    }
+
+    FileCache *file = &it->second;
+
+    if (file->pseudo) {
+        gettimeofday(&now, NULL);
+        int age = (now.tv_sec - file->timestamp.tv_sec) * 1000 +
+            (now.tv_usec - file->timestamp.tv_usec) / 1000;
+        if (age < 0 || age > PSEUDO_AGE)
+            file->stale = true;
+    } else if (file->wd < 0) {
+        /* no inotify watch available; a different inode at the path
+           means it was replaced, else compare mtime and size */
+        if (stat(path.c_str(), &st) < 0 ||
+            st.st_dev != file->dev || st.st_ino != file->ino) {
+            DropFile(path);
+            return Fetch(path);
+        }
+        if (st.st_mtime != file->mtime || st.st_size != file->size) {
+            file->mtime = st.st_mtime;
+            file->size = st.st_size;
+            file->stale = true;
+        }
+    }
+
+    if (file->stale && LoadFile(file) < 0) {
+        DropFile(path);
+        return NULL;
+    }
+
+    return file;
+}
+
 /* function 'readline' */
 /* takes two arguments, file name and line number */
 /* returns text of that line */
 
 string PluginFile::Readline(string arg1, int arg2) {
-    char value[80], val2[80];
-    FILE *fp;
-    int reqline, i, size;
+    FileCache *file = Fetch(arg1);
 
-    reqline = arg2;
-    fp = fopen(arg1.c_str(), "r");
-    if (!fp) {
+    if (!file) {
         LCDError("readline couldn't open file '%s'", arg1.c_str());
-        value[0] = '\0';
-    } else {
-        i = 0;
-        while (!feof(fp) && i++ < reqline) {
-            fgets(val2, sizeof(val2), fp);
-            size = strcspn(val2, "\r\n");
-            strncpy(value, val2, size);
-            value[size] = '\0';
-            /* more than 80 chars, chew up rest of line */
-            while (!feof(fp) && strchr(val2, '\n') == NULL) {
-                fgets(val2, sizeof(val2), fp);
-            }
-        }
-        fclose(fp);
-        if (i <= reqline) {
-            LCDError("readline requested line %d but file only had %d lines", reqline, i - 1);
-            value[0] = '\0';
-        }
+        return "";
     }
 
-    return value;
+    if (arg2 < 1 || arg2 > (int)file->lines.size()) {
+        LCDError("readline requested line %d but file only had %d lines", 
+            arg2, (int)file->lines.size());
+        return "";
+    }
+
+    const char *line = file->data.data() + file->lines[arg2 - 1];
+    size_t left = file->data.size() - file->lines[arg2 - 1];
+    size_t size = 0;
+    while (size < left && size < LINE_SIZE - 1 &&
+        line[size] != '\r' && line[size] != '\n')
+        size++;
+
+    return std::string(line, size);
 }
 
 void PluginFile::Connect(Evaluator *visitor) {
@@ -24,6 +24,12 @@
 #ifndef __PLUGIN_FILE_H__
 #define __PLUGIN_FILE_H__
 
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <sys/types.h>
+
 #include "PluginInterface.h"
 
 namespace LCD {
@@ -32,6 +38,37 @@ class Evaluator;
 
 class PluginFile {
 
+    /* one cached file: contents plus the offset of every line start */
+    typedef struct _FileCache {
+        int fd;
+        int wd;
+        int dir_wd;
+        dev_t dev;
+        ino_t ino;
+        bool stale;
+        bool pseudo;
+        time_t mtime;
+        off_t size;
+        struct timeval timestamp;
+        std::string data;
+        std::vector<size_t> lines;
+    } FileCache;
+
+    std::map<std::string, FileCache> cache_;
+    /* paths behind each watch; aliases and files in one directory share */
+    std::map<int, std::vector<std::string> > watches_;
+    int inotify_fd_;
+
+    FileCache *Fetch(std::string path);
+    int LoadFile(FileCache *file);
+    void DropFile(std::string path);
+    void Watch(int wd, std::string path);
+    void Unwatch(int wd, std::string path);
+    void ReadEvents();
+
+    public:
+    PluginFile();
+    ~PluginFile();
     void Connect(Evaluator *visitor);
     void Disconnect() {}
 
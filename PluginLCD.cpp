@@ -103,6 +103,8 @@ void PluginLCD::SendData(int row, int col,
 void PluginLCD::SetSpecialChar(int ch, SpecialChar matrix) {
     if(type_ == LCD_TEXT) {
         LCDText *lcd = (LCDText *)visitor_->GetLCD();
+        if(ch < 0 || ch >= (int)lcd->special_chars.size())
+            return;
         lcd->special_chars[ch] = matrix;
         lcd->TextSpecialCharChanged(ch);
     }
@@ -111,12 +113,9 @@ void PluginLCD::SetSpecialChar(int ch, SpecialChar matrix) {
 void PluginLCD::AddSpecialChar(SpecialChar matrix) {
     if(type_ == LCD_TEXT) {
         LCDText *lcd = (LCDText *)visitor_->GetLCD();
-        int size = lcd->special_chars.size();
-        if(size < lcd->CHARS) {
-            lcd->special_chars.push_back(
-                SpecialChar(matrix.Size()));
-            SetSpecialChar(size, matrix);
-        }
+        int ch = lcd->TextAcquireChar(matrix, false);
+        if(ch >= 0)
+            lcd->TextSpecialCharChanged(ch);
     }
 }
 
@@ -0,0 +1,448 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <sstream>
+
+#include "PluginLoader.h"
+#include "PluginCgroup.h"
+#include "PluginPSI.h"
+#include "PluginProcess.h"
+#include "debug.h"
+
+using namespace LCD;
+
+PluginLoader::PluginLoader() {
+}
+
+PluginLoader::~PluginLoader() {
+    for(std::map<std::string, Source *>::iterator it = sources_.begin();
+        it != sources_.end(); it++) {
+        Source *source = it->second;
+        if(source->plugin->close)
+            source->plugin->close(source->ctx);
+        if(source->handle)
+            dlclose(source->handle);
+        delete source;
+    }
+}
+
+// Data sources are shared objects implementing PluginABI.h. Each one
+// gets its section of "plugins" from the config. A relative
+// "plugins-dir", and the default "plugins", are taken from base, the
+// directory the config was read from. Returns the number of sources
+// registered.
+int PluginLoader::Setup(Json::Value *root, std::string base) {
+    std::string dir = "plugins";
+    Json::Value *section = NULL;
+
+    if(root && root->isObject()) {
+        if(root->isMember("plugins-dir"))
+            dir = (*root)["plugins-dir"].asString();
+        if(root->isMember("plugins"))
+            section = &(*root)["plugins"];
+    }
+
+    /* built-in sources, enabled by having a config section */
+    if(section && section->isObject() && section->isMember("cgroup"))
+        Register(PluginCgroup::Descriptor(), &(*section)["cgroup"]);
+    if(section && section->isObject() && section->isMember("pressure"))
+        Register(PluginPSI::Descriptor(), &(*section)["pressure"]);
+    if(section && section->isObject() && section->isMember("procs"))
+        Register(PluginProcess::Descriptor(), &(*section)["procs"]);
+
+    if(dir.empty() || dir[0] != '/')
+        dir = base + "/" + dir;
+
+    int loaded = Load(dir, section);
+    LCDInfo("Loaded %d data source plugins from <%s>", loaded, dir.c_str());
+    return sources_.size();
+}
+
+// Load every shared object in dir exporting LCD_PLUGIN_ENTRY.
+// Returns the number of sources loaded.
+int PluginLoader::Load(std::string dir, Json::Value *config) {
+    DIR *d = opendir(dir.c_str());
+    struct dirent *entry;
+    int loaded = 0;
+
+    if(!d) {
+        LCDInfo("PluginLoader: no plugins directory <%s>: %s", dir.c_str(),
+            strerror(errno));
+        return 0;
+    }
+
+    while((entry = readdir(d)) != NULL) {
+        std::string file = entry->d_name;
+        if(file.size() < 4 || file.substr(file.size() - 3) != ".so")
+            continue;
+
+        std::string path = dir + "/" + file;
+        void *handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if(!handle) {
+            LCDError("PluginLoader: %s", dlerror());
+            continue;
+        }
+
+        lcd_plugin_entry_fn entry_fn = 
+            (lcd_plugin_entry_fn)dlsym(handle, LCD_PLUGIN_ENTRY);
+        const lcd_plugin *plugin = entry_fn ? 
+            entry_fn(LCD_PLUGIN_ABI_VERSION) : NULL;
+
+        if(!plugin || plugin->abi_version != LCD_PLUGIN_ABI_VERSION ||
+            plugin->struct_size < sizeof(lcd_plugin)) {
+            LCDError("PluginLoader: <%s> is not an ABI %d plugin", 
+                path.c_str(), LCD_PLUGIN_ABI_VERSION);
+            dlclose(handle);
+            continue;
+        }
+
+        Json::Value *section = NULL;
+        if(config && config->isObject() && config->isMember(plugin->name))
+            section = &(*config)[plugin->name];
+
+        if(Register(plugin, section, handle) == 0)
+            loaded++;
+    }
+    closedir(d);
+    return loaded;
+}
+
+// Add a source, either from Load() or compiled in. On failure the handle
+// is closed.
+int PluginLoader::Register(const lcd_plugin *plugin, Json::Value *config,
+    void *handle) {
+
+    if(!plugin->name || !plugin->sample || 
+        sources_.find(plugin->name) != sources_.end()) {
+        LCDError("PluginLoader: unnamed or duplicate source <%s>",
+            plugin->name ? plugin->name : "");
+        if(handle) dlclose(handle);
+        return -1;
+    }
+
+    void *ctx = NULL;
+    if(plugin->open) {
+        std::string cfg;
+        if(config) {
+            Json::FastWriter writer;
+            cfg = writer.write(*config);
+        }
+        ctx = plugin->open(config ? cfg.c_str() : NULL);
+        if(!ctx) {
+            LCDError("PluginLoader: source <%s> failed to open", plugin->name);
+            if(handle) dlclose(handle);
+            return -1;
+        }
+    }
+
+    Source *source = new Source();
+    source->handle = handle;
+    source->plugin = plugin;
+    source->ctx = ctx;
+    source->timestamp.tv_sec = 0;
+    source->timestamp.tv_usec = 0;
+    source->sampled = false;
+    for(int t = 0; t < 2; t++) {
+        Table &table = source->tables[t];
+        table.rows = 0;
+        table.columns.resize(plugin->ncolumns);
+        for(int i = 0; i < plugin->ncolumns; i++) {
+            table.columns[i].name = plugin->columns[i].name;
+            table.columns[i].type = plugin->columns[i].type;
+        }
+    }
+    source->live = &source->tables[0];
+    source->back = &source->tables[1];
+    source->table.host = source;
+    source->table.set_rows = TableSetRows;
+    source->table.set_key = TableSetKey;
+    source->table.set_int = TableSetInt;
+    source->table.set_double = TableSetDouble;
+    source->table.set_string = TableSetString;
+
+    sources_[plugin->name] = source;
+    LCDInfo("PluginLoader: source <%s> with %d columns", plugin->name, 
+        plugin->ncolumns);
+    return 0;
+}
+
+// Starts the table afresh; cells the plugin then leaves unset read as
+// 0 or empty, never as what the previous sample put there.
+int PluginLoader::TableSetRows(lcd_table *table, int rows) {
+    Table *source = ((Source *)table->host)->back;
+    if(rows < 0)
+        return -1;
+    source->rows = rows;
+    source->keys.resize(rows);
+    for(int i = 0; i < rows; i++)
+        source->keys[i].clear();
+    for(unsigned int i = 0; i < source->columns.size(); i++) {
+        Column &column = source->columns[i];
+        switch(column.type) {
+        case LCD_COLUMN_INT:
+            column.ints.assign(rows, 0);
+            break;
+        case LCD_COLUMN_DOUBLE:
+            column.doubles.assign(rows, 0.0);
+            break;
+        default:
+            column.strings.resize(rows);
+            for(int r = 0; r < rows; r++)
+                column.strings[r].clear();
+            break;
+        }
+    }
+    return 0;
+}
+
+void PluginLoader::TableSetKey(lcd_table *table, int row, const char *key) {
+    Table *source = ((Source *)table->host)->back;
+    if(row < 0 || row >= source->rows)
+        return;
+    source->keys[row] = key ? key : "";
+}
+
+void PluginLoader::TableSetInt(lcd_table *table, int row, int col, 
+    int64_t value) {
+    Table *source = ((Source *)table->host)->back;
+    if(row < 0 || row >= source->rows || col < 0 || 
+        col >= (int)source->columns.size() ||
+        source->columns[col].type != LCD_COLUMN_INT)
+        return;
+    source->columns[col].ints[row] = value;
+}
+
+void PluginLoader::TableSetDouble(lcd_table *table, int row, int col, 
+    double value) {
+    Table *source = ((Source *)table->host)->back;
+    if(row < 0 || row >= source->rows || col < 0 || 
+        col >= (int)source->columns.size() ||
+        source->columns[col].type != LCD_COLUMN_DOUBLE)
+        return;
+    source->columns[col].doubles[row] = value;
+}
+
+void PluginLoader::TableSetString(lcd_table *table, int row, int col,
+    const char *value, size_t len) {
+    Table *source = ((Source *)table->host)->back;
+    if(row < 0 || row >= source->rows || col < 0 || 
+        col >= (int)source->columns.size() ||
+        source->columns[col].type != LCD_COLUMN_STRING)
+        return;
+    if(value)
+        source->columns[col].strings[row].assign(value, len);
+    else
+        source->columns[col].strings[row].clear();
+}
+
+/* like the /proc plugins, never resample within 10 msec */
+bool PluginLoader::Due(Source *source, struct timeval *now) {
+    int64_t age = (int64_t)(now->tv_sec - source->timestamp.tv_sec) * 1000 +
+        (now->tv_usec - source->timestamp.tv_usec) / 1000;
+    return age < 0 || (age >= source->plugin->interval && age > 10);
+}
+
+// A failure counts as an attempt, so a broken source is retried once
+// per interval rather than on every read.
+int PluginLoader::Sample(Source *source, struct timeval *now) {
+    uint64_t ms = (uint64_t)now->tv_sec * 1000 + now->tv_usec / 1000;
+
+    source->timestamp = *now;
+    /* no rows until the plugin calls set_rows; back keeps its buffers
+       from two samples ago so refilling it doesn't allocate */
+    source->back->rows = 0;
+    if(source->plugin->sample(source->ctx, ms, &source->table) < 0)
+        return -1;
+
+    Table *table = source->back;
+    source->back = source->live;
+    source->live = table;
+
+    table->index.clear();
+    for(int i = 0; i < table->rows; i++) {
+        if(table->keys[i] != "")
+            table->index[table->keys[i]] = i;
+    }
+    source->sampled = true;
+    return 0;
+}
+
+// Sample every source whose interval has passed. Meant to be called
+// once per tick so all expressions on that tick see the same snapshot.
+void PluginLoader::SampleAll() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    for(std::map<std::string, Source *>::iterator it = sources_.begin();
+        it != sources_.end(); it++) {
+        if(Due(it->second, &now))
+            Sample(it->second, &now);
+    }
+}
+
+// The last good table of a source. Reads never resample, except to get
+// a first table for a source no tick has reached yet.
+PluginLoader::Table *PluginLoader::Fetch(std::string name) {
+    std::map<std::string, Source *>::iterator it = sources_.find(name);
+    if(it == sources_.end())
+        return NULL;
+
+    Source *source = it->second;
+    if(!source->sampled) {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        if(Due(source, &now))
+            Sample(source, &now);
+    }
+    return source->live;
+}
+
+// How often SampleAll has something to do: the shortest interval of
+// any source, 0 with no sources.
+int PluginLoader::Interval() {
+    int interval = 0;
+    for(std::map<std::string, Source *>::iterator it = sources_.begin();
+        it != sources_.end(); it++) {
+        int i = it->second->plugin->interval;
+        if(i < 10)
+            i = 10;
+        if(interval == 0 || i < interval)
+            interval = i;
+    }
+    return interval;
+}
+
+std::vector<std::string> PluginLoader::Sources() {
+    std::vector<std::string> names;
+    for(std::map<std::string, Source *>::iterator it = sources_.begin();
+        it != sources_.end(); it++)
+        names.push_back(it->first);
+    return names;
+}
+
+std::vector<std::string> PluginLoader::Columns(std::string name) {
+    std::vector<std::string> names;
+    std::map<std::string, Source *>::iterator it = sources_.find(name);
+    if(it == sources_.end())
+        return names;
+    const lcd_plugin *plugin = it->second->plugin;
+    for(int i = 0; i < plugin->ncolumns; i++)
+        names.push_back(plugin->columns[i].name);
+    return names;
+}
+
+// lcd_column_type of a column, -1 if there is no such column.
+int PluginLoader::Type(std::string name, std::string column) {
+    std::map<std::string, Source *>::iterator it = sources_.find(name);
+    if(it == sources_.end())
+        return -1;
+    const lcd_plugin *plugin = it->second->plugin;
+    for(int i = 0; i < plugin->ncolumns; i++) {
+        if(column == plugin->columns[i].name)
+            return plugin->columns[i].type;
+    }
+    return -1;
+}
+
+int PluginLoader::ColumnIndex(Table *source, std::string column) {
+    for(unsigned int i = 0; i < source->columns.size(); i++) {
+        if(source->columns[i].name == column)
+            return i;
+    }
+    return -1;
+}
+
+int PluginLoader::RowIndex(Table *source, std::string row) {
+    std::map<std::string, int>::iterator it = source->index.find(row);
+    if(it == source->index.end())
+        return -1;
+    return it->second;
+}
+
+int PluginLoader::Rows(std::string name) {
+    Table *source = Fetch(name);
+    return source ? source->rows : 0;
+}
+
+std::string PluginLoader::Key(std::string name, int row) {
+    Table *source = Fetch(name);
+    if(!source || row < 0 || row >= source->rows)
+        return "";
+    return source->keys[row];
+}
+
+double PluginLoader::Number(std::string name, std::string column, int row) {
+    Table *source = Fetch(name);
+    if(!source || row < 0 || row >= source->rows)
+        return 0.0;
+    int col = ColumnIndex(source, column);
+    if(col < 0)
+        return 0.0;
+    switch(source->columns[col].type) {
+    case LCD_COLUMN_INT:
+        return (double)source->columns[col].ints[row];
+    case LCD_COLUMN_DOUBLE:
+        return source->columns[col].doubles[row];
+    default:
+        return strtod(source->columns[col].strings[row].c_str(), NULL);
+    }
+}
+
+double PluginLoader::Number(std::string name, std::string column, 
+    std::string row) {
+    Table *source = Fetch(name);
+    if(!source)
+        return 0.0;
+    return Number(name, column, RowIndex(source, row));
+}
+
+std::string PluginLoader::String(std::string name, std::string column, 
+    int row) {
+    Table *source = Fetch(name);
+    if(!source || row < 0 || row >= source->rows)
+        return "";
+    int col = ColumnIndex(source, column);
+    if(col < 0)
+        return "";
+    std::stringstream strm;
+    switch(source->columns[col].type) {
+    case LCD_COLUMN_INT:
+        strm << source->columns[col].ints[row];
+        return strm.str();
+    case LCD_COLUMN_DOUBLE:
+        strm << source->columns[col].doubles[row];
+        return strm.str();
+    default:
+        return source->columns[col].strings[row];
+    }
+}
+
+std::string PluginLoader::String(std::string name, std::string column, 
+    std::string row) {
+    Table *source = Fetch(name);
+    if(!source)
+        return "";
+    return String(name, column, RowIndex(source, row));
+}
@@ -0,0 +1,103 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PLUGIN_LOADER_H__
+#define __PLUGIN_LOADER_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <json/json.h>
+
+#include "PluginABI.h"
+
+namespace LCD {
+
+class PluginLoader {
+
+    typedef struct _Column {
+        std::string name;
+        int type;
+        std::vector<int64_t> ints;
+        std::vector<double> doubles;
+        std::vector<std::string> strings;
+    } Column;
+
+    typedef struct _Table {
+        int rows;
+        std::vector<Column> columns;
+        std::vector<std::string> keys;
+        std::map<std::string, int> index;
+    } Table;
+
+    /* sample() fills back from set_rows on, and the two are swapped
+       only when it succeeds; a failed sample leaves live untouched */
+    typedef struct _Source {
+        void *handle;
+        const lcd_plugin *plugin;
+        void *ctx;
+        struct timeval timestamp;   /* last attempt, failed or not */
+        bool sampled;
+        Table tables[2];
+        Table *live;
+        Table *back;
+        lcd_table table;
+    } Source;
+
+    std::map<std::string, Source *> sources_;
+
+    Table *Fetch(std::string name);
+    bool Due(Source *source, struct timeval *now);
+    int Sample(Source *source, struct timeval *now);
+    int ColumnIndex(Table *source, std::string column);
+    int RowIndex(Table *source, std::string row);
+
+    static int TableSetRows(lcd_table *table, int rows);
+    static void TableSetKey(lcd_table *table, int row, const char *key);
+    static void TableSetInt(lcd_table *table, int row, int col, int64_t value);
+    static void TableSetDouble(lcd_table *table, int row, int col, double value);
+    static void TableSetString(lcd_table *table, int row, int col,
+        const char *value, size_t len);
+
+    public:
+    PluginLoader();
+    ~PluginLoader();
+    int Setup(Json::Value *root, std::string base = ".");
+    int Load(std::string dir, Json::Value *config);
+    int Register(const lcd_plugin *plugin, Json::Value *config,
+        void *handle = NULL);
+    void SampleAll();
+    int Interval();
+    std::vector<std::string> Sources();
+    std::vector<std::string> Columns(std::string source);
+    int Type(std::string source, std::string column);
+    int Rows(std::string source);
+    std::string Key(std::string source, int row);
+    double Number(std::string source, std::string column, int row);
+    double Number(std::string source, std::string column, std::string row);
+    std::string String(std::string source, std::string column, int row);
+    std::string String(std::string source, std::string column, std::string row);
+};
+
+}; // End namespace
+
+#endif
@@ -0,0 +1,252 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "PluginPSI.h"
+#include "LCDCore.h"
+#include "LCDWrapper.h"
+#include "debug.h"
+
+using namespace LCD;
+
+static const char *pressure_files[PRESSURE_RESOURCES] = {
+    "/proc/pressure/cpu",
+    "/proc/pressure/memory",
+    "/proc/pressure/io"
+};
+
+static const lcd_column pressure_columns[] = {
+    { "some_avg10", LCD_COLUMN_DOUBLE },
+    { "some_avg60", LCD_COLUMN_DOUBLE },
+    { "some_avg300", LCD_COLUMN_DOUBLE },
+    { "some_total", LCD_COLUMN_INT },
+    { "full_avg10", LCD_COLUMN_DOUBLE },
+    { "full_avg60", LCD_COLUMN_DOUBLE },
+    { "full_avg300", LCD_COLUMN_DOUBLE },
+    { "full_total", LCD_COLUMN_INT }
+};
+
+static lcd_plugin pressure_plugin = {
+    LCD_PLUGIN_ABI_VERSION,
+    sizeof(lcd_plugin),
+    "pressure",
+    1000,
+    pressure_columns,
+    sizeof(pressure_columns) / sizeof(pressure_columns[0]),
+    NULL,
+    NULL,
+    NULL
+};
+
+const char *PluginPSI::ResourceName(int resource) {
+    static const char *names[PRESSURE_RESOURCES] = { "cpu", "memory", "io" };
+    if(resource < 0 || resource >= PRESSURE_RESOURCES)
+        return "";
+    return names[resource];
+}
+
+const lcd_plugin *PluginPSI::Descriptor() {
+    pressure_plugin.open = PluginOpen;
+    pressure_plugin.sample = PluginSample;
+    pressure_plugin.close = PluginClose;
+    return &pressure_plugin;
+}
+
+void *PluginPSI::PluginOpen(const char *config) {
+    return new PluginPSI();
+}
+
+int PluginPSI::PluginSample(void *ctx, uint64_t now, lcd_table *out) {
+    return ((PluginPSI *)ctx)->Sample(now, out);
+}
+
+void PluginPSI::PluginClose(void *ctx) {
+    delete (PluginPSI *)ctx;
+}
+
+PluginPSI::PluginPSI() {
+    for(int i = 0; i < PRESSURE_RESOURCES; i++) {
+        fds_[i] = open(pressure_files[i], O_RDONLY | O_CLOEXEC);
+        if(fds_[i] < 0)
+            LCDError("open(%s) failed: %s", pressure_files[i], strerror(errno));
+    }
+}
+
+PluginPSI::~PluginPSI() {
+    for(int i = 0; i < PRESSURE_RESOURCES; i++) {
+        if(fds_[i] >= 0)
+            close(fds_[i]);
+    }
+}
+
+/* "some avg10=0.00 avg60=0.00 avg300=0.00 total=0" */
+static void ParseLine(const char *line, lcd_table *out, int row, int col) {
+    const char *p;
+    if((p = strstr(line, "avg10=")) != NULL)
+        out->set_double(out, row, col, strtod(p + 6, NULL));
+    if((p = strstr(line, "avg60=")) != NULL)
+        out->set_double(out, row, col + 1, strtod(p + 6, NULL));
+    if((p = strstr(line, "avg300=")) != NULL)
+        out->set_double(out, row, col + 2, strtod(p + 7, NULL));
+    if((p = strstr(line, "total=")) != NULL)
+        out->set_int(out, row, col + 3, strtoll(p + 6, NULL, 10));
+}
+
+int PluginPSI::Sample(uint64_t now, lcd_table *out) {
+    char buffer[256];
+
+    out->set_rows(out, PRESSURE_RESOURCES);
+    for(int i = 0; i < PRESSURE_RESOURCES; i++) {
+        out->set_key(out, i, ResourceName(i));
+        if(fds_[i] < 0)
+            continue;
+        int len = pread(fds_[i], buffer, sizeof(buffer) - 1, 0);
+        if(len <= 0)
+            continue;
+        buffer[len] = '\0';
+        char *full = strstr(buffer, "full ");
+        if(full)
+            *(full - 1) = '\0';
+        if(strncmp(buffer, "some ", 5) == 0)
+            ParseLine(buffer, out, i, 0);
+        if(full)
+            ParseLine(full, out, i, 4);
+    }
+    return 0;
+}
+
+PressureWatcher::PressureWatcher(LCDCore *visitor) {
+    visitor_ = visitor;
+    running_.fetchAndStoreOrdered(0);
+    thread_ = new PressureThread(this);
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    if(epoll_fd_ >= 0 && wake_fd_ >= 0) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u32 = (uint32_t)-1;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+    }
+}
+
+PressureWatcher::~PressureWatcher() {
+    Stop();
+    delete thread_;
+    for(unsigned int i = 0; i < fds_.size(); i++)
+        close(fds_[i]);
+    if(epoll_fd_ >= 0)
+        close(epoll_fd_);
+    if(wake_fd_ >= 0)
+        close(wake_fd_);
+}
+
+// stall and window are in msec. The kernel wakes us once per window
+// while "some" (or "full") stall time in it exceeds stall.
+int PressureWatcher::AddTrigger(int resource, bool full, int stall, int window) {
+    char trigger[64];
+
+    if(epoll_fd_ < 0 || resource < 0 || resource >= PRESSURE_RESOURCES)
+        return -1;
+
+    int fd = open(pressure_files[resource], O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if(fd < 0) {
+        LCDError("PressureWatcher: open(%s) failed: %s", 
+            pressure_files[resource], strerror(errno));
+        return -1;
+    }
+
+    snprintf(trigger, sizeof(trigger), "%s %d %d", full ? "full" : "some",
+        stall * 1000, window * 1000);
+    if(write(fd, trigger, strlen(trigger) + 1) < 0) {
+        LCDError("PressureWatcher: trigger '%s' on %s rejected: %s", trigger,
+            pressure_files[resource], strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLPRI;
+    event.data.u32 = fds_.size();
+    if(epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    fds_.push_back(fd);
+    resources_.push_back(resource);
+    return 0;
+}
+
+void PressureWatcher::Start() {
+    if(fds_.empty() || running_.fetchAndAddOrdered(0))
+        return;
+    running_.fetchAndStoreOrdered(1);
+    thread_->start();
+}
+
+void PressureWatcher::Stop() {
+    if(!running_.fetchAndStoreOrdered(0))
+        return;
+    uint64_t one = 1;
+    if(write(wake_fd_, &one, sizeof(one)) < 0)
+        LCDError("PressureWatcher: wakeup failed: %s", strerror(errno));
+    thread_->wait();
+}
+
+void PressureWatcher::Watch() {
+    struct epoll_event events[PRESSURE_RESOURCES * 2 + 1];
+
+    while(running_.fetchAndAddOrdered(0)) {
+        int n = epoll_wait(epoll_fd_, events, 
+            sizeof(events) / sizeof(events[0]), -1);
+        if(n < 0) {
+            if(errno == EINTR)
+                continue;
+            LCDError("PressureWatcher: epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+        for(int i = 0; i < n && running_.fetchAndAddOrdered(0); i++) {
+            uint32_t id = events[i].data.u32;
+            if(id >= fds_.size())
+                continue;
+            if(events[i].events & EPOLLERR) {
+                LCDError("PressureWatcher: %s trigger went away", 
+                    PluginPSI::ResourceName(resources_[id]));
+                epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fds_[id], NULL);
+                continue;
+            }
+            /* queued to the main thread through the wrapper */
+            emit static_cast<LCDEvents *>(
+                visitor_->GetWrapper())->_PressureEvent(resources_[id]);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PLUGIN_PSI_H__
+#define __PLUGIN_PSI_H__
+
+#include <string>
+#include <vector>
+#include <QThread>
+#include <QAtomicInt>
+
+#include "PluginABI.h"
+
+#define PRESSURE_CPU 0
+#define PRESSURE_MEMORY 1
+#define PRESSURE_IO 2
+#define PRESSURE_RESOURCES 3
+
+namespace LCD {
+
+class LCDCore;
+class PressureThread;
+
+/*
+ * Pressure stall information. The "pressure" source reports the
+ * /proc/pressure averages as a table; PressureWatcher registers kernel
+ * PSI triggers and sleeps in epoll until one fires, so a calm system
+ * costs nothing.
+ */
+class PluginPSI {
+    int fds_[PRESSURE_RESOURCES];
+
+    static void *PluginOpen(const char *config);
+    static int PluginSample(void *ctx, uint64_t now, lcd_table *out);
+    static void PluginClose(void *ctx);
+
+    public:
+    PluginPSI();
+    ~PluginPSI();
+    int Sample(uint64_t now, lcd_table *out);
+    static const lcd_plugin *Descriptor();
+    static const char *ResourceName(int resource);
+};
+
+class PressureWatcher {
+    LCDCore *visitor_;
+    PressureThread *thread_;
+    std::vector<int> fds_;
+    std::vector<int> resources_;
+    int epoll_fd_;
+    int wake_fd_;
+    // Cleared by Stop() while Watch() polls it on the watcher thread.
+    QAtomicInt running_;
+
+    public:
+    PressureWatcher(LCDCore *visitor);
+    ~PressureWatcher();
+    int AddTrigger(int resource, bool full, int stall, int window);
+    void Start();
+    void Stop();
+    void Watch();
+};
+
+class PressureThread : public QThread {
+    Q_OBJECT
+    PressureWatcher *visitor_;
+
+    protected:
+    void run() { visitor_->Watch(); }
+
+    public:
+    PressureThread(PressureWatcher *v) { visitor_ = v; }
+};
+
+}; // End namespace
+
+#endif
@@ -0,0 +1,288 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <json/json.h>
+
+#include "PluginProcess.h"
+#include "debug.h"
+
+using namespace LCD;
+
+static const lcd_column process_columns[] = {
+    { "pid", LCD_COLUMN_INT },
+    { "comm", LCD_COLUMN_STRING },
+    { "cpu", LCD_COLUMN_DOUBLE },           /* percent of one cpu */
+    { "rss", LCD_COLUMN_INT }               /* bytes */
+};
+
+static lcd_plugin process_plugin = {
+    LCD_PLUGIN_ABI_VERSION,
+    sizeof(lcd_plugin),
+    "procs",
+    1000,
+    process_columns,
+    sizeof(process_columns) / sizeof(process_columns[0]),
+    NULL,
+    NULL,
+    NULL
+};
+
+const lcd_plugin *PluginProcess::Descriptor() {
+    process_plugin.open = PluginOpen;
+    process_plugin.sample = PluginSample;
+    process_plugin.close = PluginClose;
+    return &process_plugin;
+}
+
+void *PluginProcess::PluginOpen(const char *config) {
+    PluginProcess *procs = new PluginProcess(config);
+    if(!procs->proc_) {
+        delete procs;
+        return NULL;
+    }
+    return procs;
+}
+
+int PluginProcess::PluginSample(void *ctx, uint64_t now, lcd_table *out) {
+    return ((PluginProcess *)ctx)->Sample(now, out);
+}
+
+void PluginProcess::PluginClose(void *ctx) {
+    delete (PluginProcess *)ctx;
+}
+
+// config: { "top": 5, "max-fds": 512 }
+PluginProcess::PluginProcess(const char *config) {
+    Json::Reader reader;
+    Json::Value cfg;
+
+    if(config)
+        reader.parse(config, cfg);
+
+    /* leave half the fd limit to everything else */
+    struct rlimit limit;
+    int fds = 512;
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+        fds = limit.rlim_cur / 2;
+
+    top_ = cfg.get("top", 5).asInt();
+    max_fds_ = cfg.get("max-fds", fds).asInt();
+    open_fds_ = 0;
+    hertz_ = sysconf(_SC_CLK_TCK);
+    page_size_ = sysconf(_SC_PAGESIZE);
+    last_sample_ = 0;
+
+    if(top_ < 1)
+        top_ = 1;
+
+    proc_ = opendir("/proc");
+    if(!proc_)
+        LCDError("procs: can't open /proc: %s", strerror(errno));
+}
+
+PluginProcess::~PluginProcess() {
+    while(!procs_.empty())
+        Remove(procs_.begin());
+    if(proc_)
+        closedir(proc_);
+}
+
+int PluginProcess::OpenStat(int pid) {
+    char path[32];
+    snprintf(path, sizeof(path), "%d/stat", pid);
+    return openat(dirfd(proc_), path, O_RDONLY | O_CLOEXEC);
+}
+
+void PluginProcess::Add(int pid) {
+    Process *proc = new Process();
+
+    proc->pid = pid;
+    proc->fd = -1;
+    proc->seen = true;
+    proc->primed = false;
+    proc->comm[0] = '\0';
+
+    if(open_fds_ < max_fds_ && (proc->fd = OpenStat(pid)) >= 0)
+        open_fds_++;
+    procs_[pid] = proc;
+}
+
+void PluginProcess::Remove(std::map<int, Process *>::iterator it) {
+    Process *proc = it->second;
+    if(proc->fd >= 0) {
+        close(proc->fd);
+        open_fds_--;
+    }
+    delete proc;
+    procs_.erase(it);
+}
+
+// Pick up new pids and drop exited ones. Known pids keep their stat fd
+// and previous counters.
+void PluginProcess::Scan() {
+    for(std::map<int, Process *>::iterator it = procs_.begin();
+        it != procs_.end(); it++)
+        it->second->seen = false;
+
+    rewinddir(proc_);
+    struct dirent *entry;
+    while((entry = readdir(proc_)) != NULL) {
+        if(entry->d_name[0] < '1' || entry->d_name[0] > '9')
+            continue;
+        int pid = atoi(entry->d_name);
+        std::map<int, Process *>::iterator it = procs_.find(pid);
+        if(it == procs_.end())
+            Add(pid);
+        else
+            it->second->seen = true;
+    }
+
+    for(std::map<int, Process *>::iterator it = procs_.begin();
+        it != procs_.end(); ) {
+        std::map<int, Process *>::iterator next = it;
+        next++;
+        if(!it->second->seen)
+            Remove(it);
+        it = next;
+    }
+}
+
+/* "pid (comm) state ppid ..." -- comm may hold spaces and parens, so
+   fields are counted from the last ')' */
+int PluginProcess::ReadProcess(Process *proc, double dt) {
+    char buffer[1024];
+    int len = -1;
+
+    /* a kept fd fails once its process exits, but the pid may already
+       belong to a new one; let go of it and look the pid up again */
+    if(proc->fd >= 0 && (len = pread(proc->fd, buffer,
+        sizeof(buffer) - 1, 0)) <= 0) {
+        close(proc->fd);
+        proc->fd = -1;
+        open_fds_--;
+    }
+    if(len <= 0) {
+        int fd = OpenStat(proc->pid);
+        if(fd < 0)
+            return -1;      /* exited, next scan drops it */
+        len = pread(fd, buffer, sizeof(buffer) - 1, 0);
+        if(len > 0 && open_fds_ < max_fds_) {
+            proc->fd = fd;
+            open_fds_++;
+        } else {
+            close(fd);
+        }
+    }
+    if(len <= 0)
+        return -1;
+    buffer[len] = '\0';
+
+    char *name = strchr(buffer, '(');
+    char *end = strrchr(buffer, ')');
+    if(!name || !end || end[1] != ' ')
+        return -1;
+
+    /* fields 3 (state) through 24 (rss) */
+    uint64_t fields[22];
+    char *p = end + 2;
+    for(int i = 0; i < 22; i++) {
+        while(*p == ' ') p++;
+        fields[i] = strtoull(p, &p, 10);
+        if(i == 0)
+            p++;        /* state is a letter */
+    }
+    uint64_t ticks = fields[11] + fields[12];       /* utime + stime */
+    uint64_t starttime = fields[19];
+
+    if(!proc->primed || proc->starttime != starttime) {
+        /* new pid, or pid reused since the last sample */
+        size_t n = std::min((size_t)(end - name - 1), sizeof(proc->comm) - 1);
+        memcpy(proc->comm, name + 1, n);
+        proc->comm[n] = '\0';
+        proc->cpu = 0.0;
+    } else if(dt > 0) {
+        proc->cpu = (ticks - proc->ticks) * 100.0 / (hertz_ * dt);
+    }
+    proc->ticks = ticks;
+    proc->starttime = starttime;
+    proc->rss = (int64_t)fields[21] * page_size_;
+    proc->primed = true;
+    return 0;
+}
+
+struct ProcessByCpu {
+    template <class T> bool operator()(const T *a, const T *b) const {
+        return a->cpu > b->cpu;
+    }
+};
+
+struct ProcessByRss {
+    template <class T> bool operator()(const T *a, const T *b) const {
+        return a->rss > b->rss;
+    }
+};
+
+int PluginProcess::Sample(uint64_t now, lcd_table *out) {
+    Scan();
+
+    double dt = last_sample_ ? (now - last_sample_) / 1000.0 : 0.0;
+    last_sample_ = now;
+
+    order_.clear();
+    for(std::map<int, Process *>::iterator it = procs_.begin();
+        it != procs_.end(); it++) {
+        if(ReadProcess(it->second, dt) == 0)
+            order_.push_back(it->second);
+    }
+
+    int top = std::min(top_, (int)order_.size());
+    out->set_rows(out, top * 2);
+
+    for(int pass = 0; pass < 2; pass++) {
+        if(pass == 0)
+            std::partial_sort(order_.begin(), order_.begin() + top,
+                order_.end(), ProcessByCpu());
+        else
+            std::partial_sort(order_.begin(), order_.begin() + top,
+                order_.end(), ProcessByRss());
+
+        for(int i = 0; i < top; i++) {
+            Process *proc = order_[i];
+            int row = pass * top + i;
+            char key[16];
+            snprintf(key, sizeof(key), "%s%d", pass ? "rss" : "cpu", i + 1);
+            out->set_key(out, row, key);
+            out->set_int(out, row, 0, proc->pid);
+            out->set_string(out, row, 1, proc->comm, strlen(proc->comm));
+            out->set_double(out, row, 2, proc->cpu);
+            out->set_int(out, row, 3, proc->rss);
+        }
+    }
+    return 0;
+}
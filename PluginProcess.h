@@ -0,0 +1,83 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PLUGIN_PROCESS_H__
+#define __PLUGIN_PROCESS_H__
+
+#include <map>
+#include <vector>
+#include <dirent.h>
+
+#include "PluginABI.h"
+
+namespace LCD {
+
+/*
+ * Top processes by cpu and rss. /proc is opened once and each pid's stat
+ * file is kept open while the pid lives (up to "max-fds"), so a sample is
+ * one readdir pass plus one pread per process. Rows are keyed "cpu1" to
+ * "cpuN" followed by "rss1" to "rssN". Registered with PluginLoader as
+ * source "procs".
+ */
+class PluginProcess {
+
+    typedef struct _Process {
+        int pid;
+        int fd;
+        bool seen;
+        bool primed;
+        uint64_t starttime;
+        uint64_t ticks;
+        int64_t rss;
+        double cpu;
+        char comm[32];
+    } Process;
+
+    DIR *proc_;
+    int top_;
+    int max_fds_;
+    int open_fds_;
+    long hertz_;
+    long page_size_;
+    uint64_t last_sample_;
+    std::map<int, Process *> procs_;
+    std::vector<Process *> order_;
+
+    void Scan();
+    void Add(int pid);
+    int OpenStat(int pid);
+    int ReadProcess(Process *proc, double dt);
+    void Remove(std::map<int, Process *>::iterator it);
+
+    static void *PluginOpen(const char *config);
+    static int PluginSample(void *ctx, uint64_t now, lcd_table *out);
+    static void PluginClose(void *ctx);
+
+    public:
+    PluginProcess(const char *config);
+    ~PluginProcess();
+    int Sample(uint64_t now, lcd_table *out);
+    static const lcd_plugin *Descriptor();
+};
+
+}; // End namespace
+
+#endif
@@ -19,89 +19,96 @@
  * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "debug.h"
 #include "SpecialChar.h"
 
 using namespace LCD;
 
+static int ClampSize(int size) {
+    if(size > SPECIAL_CHAR_ROWS) {
+        LCDError("SpecialChar: %d rows exceeds %d", size, SPECIAL_CHAR_ROWS);
+        return SPECIAL_CHAR_ROWS;
+    }
+    return size < 0 ? 0 : size;
+}
+
 SpecialChar::SpecialChar(int *ch, int size) {
-    for(int i = 0; i < size; i++) {
+    memset(chars_, 0, sizeof(chars_));
+    size_ = ClampSize(size);
+    for(int i = 0; i < size_; i++) {
         chars_[i] = ch[i];
     }
-    size_ = size;
 }
 
 SpecialChar::SpecialChar(int size) {
-    for(int i = 0; i < size; i++) {
-        chars_[i] = 0;
-    }
-    size_ = size;
+    memset(chars_, 0, sizeof(chars_));
+    size_ = ClampSize(size);
 }
 
 SpecialChar::SpecialChar() {
+    memset(chars_, 0, sizeof(chars_));
     size_ = 0;
 }
 
-int &SpecialChar::operator[](int i) {
-    if(i >= size_) {
+uint8_t &SpecialChar::operator[](int i) {
+    if(i < 0 || i >= size_) {
         LCDError("SpecialChar: index out of range <%d,%d>", i, size_);
         return chars_[0];
     }
     return chars_[i];
 }
 
-bool SpecialChar::operator==(const SpecialChar &rhv) {
-    if( size_ != rhv.Size() )
-        return false;
-    for(int i = 0; i < size_; i++ )
-        if( chars_[i] != rhv.Chars()[i] )
-            return false;
-    return true;
+uint8_t SpecialChar::operator[](int i) const {
+    if(i < 0 || i >= size_)
+        return 0;
+    return chars_[i];
 }
 
-bool SpecialChar::operator!=(const SpecialChar &rhv) {
-    return !(*this == rhv);
+bool SpecialChar::operator==(const SpecialChar &rhv) const {
+    return size_ == rhv.size_ && memcmp(chars_, rhv.chars_, size_) == 0;
 }
 
-SpecialChar &SpecialChar::operator=(const SpecialChar &rhv) {
-    if(this == &rhv)
-        return *this;
-    
-    size_ = rhv.Size();
-    chars_ = rhv.Chars();
+bool SpecialChar::operator!=(const SpecialChar &rhv) const {
+    return !(*this == rhv);
+}
 
-    return *this;
+std::map<int, int> SpecialChar::Chars() const {
+    std::map<int, int> chars;
+    for(int i = 0; i < size_; i++)
+        chars[i] = chars_[i];
+    return chars;
 }
 
 void SpecialChar::AddChar(int ch) {
+    if(size_ >= SPECIAL_CHAR_ROWS) {
+        LCDError("SpecialChar: %d rows exceeds %d", size_ + 1, 
+            SPECIAL_CHAR_ROWS);
+        return;
+    }
     chars_[size_++] = ch;
 }
 
 // Programmer must insure data is allocated
 void SpecialChar::Data(int *data) {
-    for(unsigned int i = 0; i < chars_.size(); i++ ) {
+    for(int i = 0; i < size_; i++ ) {
         data[i] = chars_[i];
     }
-    size_ = chars_.size();
 }
 
 std::vector<int> SpecialChar::Vector() const {
-    std::vector<int> data;
-    std::map<int, int> chars = chars_;
-    for(unsigned int i = 0; i < chars.size(); i++ ) {
-        data.push_back(chars[i]);
-    }
-    return data;
+    return std::vector<int>(chars_, chars_ + size_);
+}
+
+// FNV-1a over the row bits
+unsigned int SpecialChar::Hash() const {
+    unsigned int hash = 2166136261u;
+    for(int i = 0; i < size_; i++)
+        hash = (hash ^ chars_[i]) * 16777619u;
+    return (hash ^ size_) * 16777619u;
 }
 
 bool SpecialChar::Compare(SpecialChar other) {
-    bool flag = true;
-    if(Size() != other.Size()) flag = false;
-    else {
-        for(int i = 0; i < Size(); i++) {
-            if(other[i] != chars_[i])
-                flag = false;
-        }
-    }
-    return flag;
+    return *this == other;
 }
@@ -24,11 +24,16 @@
 
 #include <map>
 #include <vector>
+#include <stdint.h>
+
+#define SPECIAL_CHAR_ROWS 16
 
 namespace LCD {
 
+// One glyph, a row of pixel bits per entry. Stored inline with unused rows
+// kept zero, so copies are a flat struct copy and equality is a memcmp.
 class SpecialChar {
-    std::map<int, int> chars_;
+    uint8_t chars_[SPECIAL_CHAR_ROWS];
     int size_;
 
     public:
@@ -36,15 +41,17 @@ class SpecialChar {
     SpecialChar(int *ch, int size);
     SpecialChar(int size);
     int Size() const { return size_; };
-    std::map<int, int> Chars() const { return chars_; };
+    std::map<int, int> Chars() const;
+    const uint8_t *Rows() const { return chars_; }
     void AddChar(int ch);
     void Data(int *data);
     std::vector<int> Vector() const;
+    unsigned int Hash() const;
     bool Compare(SpecialChar other);
-    int &operator[](int i);
-    bool operator==(const SpecialChar &ch);
-    bool operator!=(const SpecialChar &ch);
-    SpecialChar &operator=(const SpecialChar &rhv);
+    uint8_t &operator[](int i);
+    uint8_t operator[](int i) const;
+    bool operator==(const SpecialChar &ch) const;
+    bool operator!=(const SpecialChar &ch) const;
 };
 
 }; // End namespace
@@ -0,0 +1,78 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "TextComposite.h"
+
+using namespace LCD;
+
+void LCD::TextComposite(unsigned char *dst, unsigned char **layers,
+    int nlayers, int pos, int len) {
+    int n = 0;
+
+    if(nlayers == 1) {
+        memcpy(dst + pos, layers[0] + pos, len);
+        return;
+    }
+
+#if defined(__AVX2__)
+    const __m256i blank32 = _mm256_set1_epi8(' ');
+    for(; n + 32 <= len; n += 32) {
+        __m256i cell = blank32;
+        for(int l = nlayers - 1; l >= 0; l--) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(layers[l] + pos + n));
+            __m256i clear = _mm256_cmpeq_epi8(v, blank32);
+            cell = _mm256_blendv_epi8(v, cell, clear);
+        }
+        _mm256_storeu_si256((__m256i *)(dst + pos + n), cell);
+    }
+#endif
+
+#if defined(__SSE2__)
+    const __m128i blank16 = _mm_set1_epi8(' ');
+    for(; n + 16 <= len; n += 16) {
+        __m128i cell = blank16;
+        for(int l = nlayers - 1; l >= 0; l--) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(layers[l] + pos + n));
+            __m128i clear = _mm_cmpeq_epi8(v, blank16);
+            cell = _mm_or_si128(_mm_and_si128(clear, cell),
+                _mm_andnot_si128(clear, v));
+        }
+        _mm_storeu_si128((__m128i *)(dst + pos + n), cell);
+    }
+#endif
+
+    for(; n < len; n++) {
+        unsigned char cell = ' ';
+        for(int l = nlayers - 1; l >= 0; l--) {
+            if(layers[l][pos + n] != ' ')
+                cell = layers[l][pos + n];
+        }
+        dst[pos + n] = cell;
+    }
+}
@@ -0,0 +1,38 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TEXT_COMPOSITE_H__
+#define __TEXT_COMPOSITE_H__
+
+namespace LCD {
+
+/*
+ * Merge text layers into dst for cells [pos, pos + len). Layer 0 is on
+ * top and ' ' is transparent, so a cell shows the first non-blank layer
+ * or a blank. Works 32 (AVX2) or 16 (SSE2) cells at a time when the
+ * compiler targets those, with a scalar tail.
+ */
+void TextComposite(unsigned char *dst, unsigned char **layers, int nlayers,
+    int pos, int len);
+
+}; // End namespace
+
+#endif
@@ -0,0 +1,75 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+#include "TextPlanner.h"
+
+using namespace LCD;
+
+void LCD::TextPlanRow(const unsigned char *display, const unsigned char *fb,
+    int row, int first, int last, int overhead, std::vector<TextSpan> &plan) {
+    std::vector<int> changed;
+
+    for(int c = first; c <= last; c++) {
+        if(display[c] != fb[c])
+            changed.push_back(c);
+    }
+
+    int m = changed.size();
+    if(m == 0)
+        return;
+
+    /* cost[k]: cheapest way to send the first k changed cells;
+       start[k]: index of the first changed cell in the last span */
+    std::vector<int> cost(m + 1, 0);
+    std::vector<int> start(m + 1, 0);
+
+    for(int k = 1; k <= m; k++) {
+        int end = changed[k - 1];
+        cost[k] = -1;
+        for(int j = k - 1; j >= 0; j--) {
+            int c = cost[j] + overhead + end - changed[j] + 1;
+            /* ties go to the longer span, fewer packets */
+            if(cost[k] < 0 || c <= cost[k]) {
+                cost[k] = c;
+                start[k] = j;
+            }
+            /* longer spans only cost more from here on */
+            if(overhead + end - changed[j] + 1 > cost[k])
+                break;
+        }
+    }
+
+    size_t base = plan.size();
+    for(int k = m; k > 0; k = start[k]) {
+        TextSpan span;
+        span.row = row;
+        span.col = changed[start[k]];
+        span.len = changed[k - 1] - span.col + 1;
+        span.data = NULL;
+        plan.push_back(span);
+    }
+    /* spans were found right to left */
+    std::reverse(plan.begin() + base, plan.end());
+}
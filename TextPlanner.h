@@ -0,0 +1,50 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TEXT_PLANNER_H__
+#define __TEXT_PLANNER_H__
+
+#include <vector>
+
+namespace LCD {
+
+// One cursor move followed by len bytes of data.
+typedef struct _TextSpan {
+    int row;
+    int col;
+    int len;
+    unsigned char *data;
+} TextSpan;
+
+/*
+ * Choose the spans that bring display up to date with fb over columns
+ * [first, last] of one row. Every span costs overhead bytes (cursor goto
+ * plus packet framing) and one byte per cell, unchanged cells included,
+ * so two runs are joined only when the cells between them are cheaper
+ * than a new span. Solved exactly with a DP over the changed cells.
+ * Spans are appended to plan with data left NULL.
+ */
+void TextPlanRow(const unsigned char *display, const unsigned char *fb,
+    int row, int first, int last, int overhead, std::vector<TextSpan> &plan);
+
+}; // End namespace
+
+#endif
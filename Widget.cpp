@@ -88,5 +88,6 @@ int Widget::WidgetColor(Json::Value *section, std::string key, RGBA *C) {
 
 
 void Widget::SetupChars() {}
+int Widget::PlanChars(std::vector<SpecialChar> &glyphs) { return 0; }
 void Widget::Start() {}
 void Widget::Stop() {}
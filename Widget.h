@@ -25,8 +25,10 @@
 #include <iostream>
 #include <json/json.h>
 #include <string>
+#include <vector>
 
 #include "RGBA.h"
+#include "SpecialChar.h"
 
 namespace LCD {
 
@@ -69,6 +71,8 @@ class Widget {
     virtual void Start();
     virtual void Stop();
     virtual void SetupChars();
+    // Shared glyphs SetupChars will ask for; returns its private count.
+    virtual int PlanChars(std::vector<SpecialChar> &glyphs);
     LCDCore *GetVisitor() { return visitor_; };
     bool GetStarted() const { return started_; }
     int GetRow() const { return row_; }
@@ -141,85 +141,40 @@ void WidgetBar::Resize(int rows, int cols, int old_rows, int old_cols) {
     Update();
 }
 
-void WidgetBar::SetupChars() {
-    LCDText *lcd = (LCDText *)visitor_->GetLCD();
-    ch_.clear();
+int WidgetBar::PlanChars(std::vector<SpecialChar> &glyphs) {
     if( style_ == STYLE_HOLLOW and not expression2_->Valid()) {
-        for( int i = 0; i < 4; i++ ) {
-            for( int j = 0; j < (int)lcd->special_chars.size(); j++ ) {
-                SpecialChar c(SCHARS[i], 8);
-                if( lcd->special_chars[j] == c ) {
-                    ch_[i] = j;
-                }
-            }
-
-        }
-        for(int i = 0; i < 6; i++ ) {
-            std::map<const int, char>::iterator it = ch_.find(i);
-            if(it != ch_.end()) {
-                if((int)lcd->special_chars.size() >= lcd->CHARS ) {
-                    LCDError("Can not allot char for widget: %s",name_.c_str());
-                    update_ = -1;
-                    return;
-                }
-                lcd->special_chars.push_back(SpecialChar(SCHARS[i], 8));
-                ch_[i] = lcd->special_chars.size() - 1;
-                lcd->TextSpecialCharChanged(ch_[i]);
-            }
-        }
+        for(int i = 0; i < 4; i++ )
+            glyphs.push_back(SpecialChar(SCHARS[i], 8));
     } else if (style_ == STYLE_NORMAL ) {
-        for(unsigned int j = 0; j < lcd->special_chars.size(); j++ ) {
-            if( lcd->special_chars[j] == SpecialChar(SCHARS[0], 8)) {
-                ch_[0] = j;
-            }
-            if( lcd->special_chars[j] == SpecialChar(SCHARS[4], 8)) {
-                ch_[1] = j;
-            }
-            if( lcd->special_chars[j] == SpecialChar(SCHARS[5], 8)) {
-                ch_[2] = j;
-            }
-        }
-        std::map<const int, char>::iterator it;
-
-        it = ch_.find(0);
-        if(it == ch_.end()) {
-            if((int)lcd->special_chars.size() >= lcd->CHARS ) {
-                LCDError("Can not allot char for bar widget: %s",name_.c_str());
-                update_ = -1;
-                return;
-            }
-            lcd->special_chars.push_back(SpecialChar(SCHARS[0], 8));
-            ch_[0] = lcd->special_chars.size() - 1;
-            lcd->TextSpecialCharChanged(ch_[0]);
-        }
-
-        it = ch_.find(1);
-        if(it == ch_.end() && expression2_->Valid()) {
-            if( (int)lcd->special_chars.size() >= lcd->CHARS ) {
-                LCDError("Can not allot char for bar widget: %s",name_.c_str());
-                update_ = -1;
-                return;
-            }
-            lcd->special_chars.push_back(SpecialChar(SCHARS[4], 8));
-            ch_[1] = lcd->special_chars.size() - 1;
-            lcd->TextSpecialCharChanged(ch_[1]);
+        glyphs.push_back(SpecialChar(SCHARS[0], 8));
+        if(expression2_->Valid()) {
+            glyphs.push_back(SpecialChar(SCHARS[4], 8));
+            glyphs.push_back(SpecialChar(SCHARS[5], 8));
         }
+    }
+    return 0;
+}
 
-        it = ch_.find(2);
-        if(it == ch_.end() && expression2_->Valid()) {
-            if( (int)lcd->special_chars.size() >= lcd->CHARS ) {
-                LCDError("Can not allot char for bar widget: %s",name_.c_str());
-                update_ = -1;
-                return;
-            }
-            lcd->special_chars.push_back(SpecialChar(SCHARS[5], 8));
-            ch_[2] = lcd->special_chars.size() - 1;
-            lcd->TextSpecialCharChanged(ch_[2]);
-        }
-        
-    } else {
+void WidgetBar::SetupChars() {
+    LCDText *lcd = (LCDText *)visitor_->GetLCD();
+    std::vector<SpecialChar> glyphs;
+    ch_.clear();
+    PlanChars(glyphs);
+    if(glyphs.empty()) {
         LCDError("%s: Either choose style (H)ollow or have a 2nd expression.", 
             widget_base_.c_str());
+        return;
+    }
+
+    for(int i = 0; i < (int)glyphs.size(); i++ ) {
+        int ch = lcd->TextAcquireChar(glyphs[i]);
+        if(ch < 0) {
+            LCDError("Can not allot char for bar widget: %s",name_.c_str());
+            update_ = -1;
+            return;
+        }
+        ch_[i] = ch;
+        lcd->TextSpecialCharChanged(ch);
     }
 }
 
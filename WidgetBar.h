@@ -73,6 +73,7 @@ class WidgetBar : public Widget {
         Json::Value *section, int row, int col, int layer);
     ~WidgetBar();
     void SetupChars();
+    int PlanChars(std::vector<SpecialChar> &glyphs);
     void Start();
     void Stop();
     DIRECTION GetDirection() { return direction_; }
@@ -86,17 +86,21 @@ void WidgetBignums::Resize(int rows, int cols, int old_rows, int old_cols) {
     Update();
 }
 
+int WidgetBignums::PlanChars(std::vector<SpecialChar> &glyphs) {
+    return 8;
+}
+
 void WidgetBignums::SetupChars() {
     ch_.clear();
     LCDText *lcd = (LCDText *)visitor_->GetLCD();
     for(int i = 0; i < 8; i++) {
-        if((int)lcd->special_chars.size() >= lcd->CHARS ) {
+        int ch = lcd->TextAcquireChar(SpecialChar(8), false);
+        if(ch < 0) {
             LCDError("Can not allot char for widget: %s", name_.c_str());
             update_ = -1;
             return;
         }
-        lcd->special_chars.push_back(SpecialChar(8));
-        ch_.push_back(lcd->special_chars.size() - 1);
+        ch_.push_back(ch);
     }
 }
 
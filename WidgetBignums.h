@@ -61,6 +61,7 @@ class WidgetBignums : public Widget {
     ~WidgetBignums();
     void TextScroll() {};
     void SetupChars();
+    int PlanChars(std::vector<SpecialChar> &glyphs);
     void Update();
     void Start();
     void Stop();
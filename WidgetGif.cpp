@@ -277,6 +277,10 @@ void WidgetGif::Stop() {
     ch_.clear();
 }
 
+int WidgetGif::PlanChars(std::vector<SpecialChar> &glyphs) {
+    return rows_ * cols_;
+}
+
 void WidgetGif::SetupChars() {
     LCDText *lcd = (LCDText *)visitor_->GetLCD();
     ch_.resize(rows_ * cols_);
@@ -303,15 +307,15 @@ void WidgetGif::SetupChars() {
         }
     }
     for(int i = 0; i < rows_ * cols_; i++) {
-       if( (int)lcd->special_chars.size() >= lcd->CHARS ) {
+       int ch = lcd->TextAcquireChar(SpecialChar(lcd->YRES), false);
+       if( ch < 0 ) {
            LCDError("2) GIF too large: %s", name_.c_str());
            if( update_) delete update_;
            update_ = new Property(visitor_, section_, "", 
                new Json::Value("-1"));
            return;
        }
-       lcd->special_chars.push_back(SpecialChar(lcd->YRES));
-       ch_[i] = lcd->special_chars.size() - 1; 
+       ch_[i] = ch; 
     }
     has_chars_ = true;
 }
@@ -65,6 +65,7 @@ class WidgetGif : public Widget {
     void Start();
     void Stop();
     void SetupChars();
+    int PlanChars(std::vector<SpecialChar> &glyphs);
     bool HasChars() { return has_chars_; };
     RGBA *Bitmap() { return bitmap_; };
     std::vector<char> GetChars() { return ch_; };
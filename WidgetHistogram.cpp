@@ -109,35 +109,33 @@ WidgetHistogram::~WidgetHistogram() {
     delete timer_;
 }
 
-void WidgetHistogram::SetupChars() {
-    ch_.clear();
+int WidgetHistogram::PlanChars(std::vector<SpecialChar> &glyphs) {
     LCDText *lcd = (LCDText *)visitor_->GetLCD();
     for(int c = 0; c < (int)lcd->YRES; c++ ) {
         SpecialChar buffer(lcd->YRES);;
         for(int i = lcd->YRES - 1; i >= 0; i-- ) {
             buffer[lcd->YRES - i - 1] = (i < c ? pow(2, lcd->XRES)-1-gap_ : 0);
         }
+        glyphs.push_back(buffer);
+    }
+    return 0;
+}
 
-        bool reused = false;
-
-        for(unsigned int i = 0; i < lcd->special_chars.size(); i++ ) {
-            if( buffer == lcd->special_chars[i] ) {
-                ch_[c] = i;
-                reused = true;
-                break;
-            }
-        }
-
-        if( lcd->CHARS < (int)lcd->special_chars.size() ) {
+void WidgetHistogram::SetupChars() {
+    ch_.clear();
+    LCDText *lcd = (LCDText *)visitor_->GetLCD();
+    std::vector<SpecialChar> glyphs;
+    PlanChars(glyphs);
+    for(int c = 0; c < (int)glyphs.size(); c++ ) {
+        int ch = lcd->TextAcquireChar(glyphs[c]);
+        if( ch < 0 ) {
             update_ = -1;
             LCDError("Widget %s - unable to allocate special chars", 
                 name_.c_str());
             return;
         }
 
-        if( reused ) continue;
-        lcd->special_chars.push_back(buffer);
-        ch_[c] = lcd->special_chars.size() - 1;
+        ch_[c] = ch;
         lcd->TextSpecialCharChanged(ch_[c]);
     }
 }
@@ -64,6 +64,7 @@ class WidgetHistogram : public Widget {
         Json::Value *section, int row, int col, int layer);
     ~WidgetHistogram();
     void SetupChars();
+    int PlanChars(std::vector<SpecialChar> &glyphs);
     void Start();
     void Stop();
     std::map<char, char> GetCh() { return ch_; }
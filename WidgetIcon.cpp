@@ -136,6 +136,10 @@ void WidgetIcon::Resize(int rows, int cols, int old_rows, int old_cols) {
     Update();
 }
 
+int WidgetIcon::PlanChars(std::vector<SpecialChar> &glyphs) {
+    return 1;
+}
+
 void WidgetIcon::SetupChars() {
     std::map<std::string, Widget *> widgets = visitor_->GetWidgets();
     for(std::map<std::string, Widget *>::iterator it = 
@@ -148,13 +152,12 @@ void WidgetIcon::SetupChars() {
         }
     }
     LCDText *lcd = (LCDText *)visitor_->GetLCD();
-    if((int)lcd->special_chars.size() >= lcd->CHARS) {
+    ch_ = lcd->TextAcquireChar(SpecialChar(lcd->YRES), false);
+    if(ch_ < 0) {
         LCDError("Can not allot char for widget: %s", name_.c_str());
         update_ = -1;
         return;
     }
-    lcd->special_chars.push_back(SpecialChar(lcd->YRES));
-    ch_ = lcd->special_chars.size() - 1;
 }
 
 void WidgetIcon::Update() {
@@ -58,6 +58,7 @@ class WidgetIcon : public Widget {
     WidgetIcon(LCDCore *visitor, std::string name, Json::Value *section, int row, int col, int layer);
     ~WidgetIcon();
     void SetupChars();
+    int PlanChars(std::vector<SpecialChar> &glyphs);
     void Start();
     void Stop();
     SpecialChar GetBitmap() { return *bitmap_; }
@@ -403,18 +403,24 @@ bool WidgetVisualization::ErrorHandler(const std::string &function,
     return false;
 }
 
+int WidgetVisualization::PlanChars(std::vector<SpecialChar> &glyphs) {
+    LCDText *lcd = (LCDText *)visitor_->GetLCD();
+    if(style_ == STYLE_PCM)
+        return 8;
+    int size = style_ == STYLE_PEAK ? 6 : 2;
+    for(int c = 0; c < size; c++)
+        glyphs.push_back(SpecialChar(VISUALIZATION_CHARS[c], lcd->YRES));
+    return 0;
+}
+
 void WidgetVisualization::SetupChars() {
 LCDError("SetupChars");
     ch_.clear();
     LCDText *lcd = (LCDText *)visitor_->GetLCD();
 
-    int size;
-    if(style_ == STYLE_PCM)
-        size = 8;
-    else if(style_ == STYLE_PEAK)
-        size = 6;
-    else
-        size = 2;
+    std::vector<SpecialChar> glyphs;
+    int privates = PlanChars(glyphs);
+    int size = privates + glyphs.size();
 
 
 /*
@@ -437,20 +443,20 @@ LCDError("SetupChars");
     }
 */
 
-    if( (int)lcd->special_chars.size() >= lcd->CHARS - size) {
-        update_ = -1;
-        LCDError("Widget %s - unable to allocate special chars. CHARS: %d, chars_cache: %d, size: %d", 
-            name_.c_str(), lcd->CHARS, lcd->special_chars.size(), size);
-        return;
-    }
-
     for(int c = 0; c < size; c++) {
-        if(style_ != STYLE_PCM)
-            lcd->special_chars.push_back(SpecialChar(VISUALIZATION_CHARS[c], lcd->YRES));
+        int ch;
+        if(c < (int)glyphs.size())
+            ch = lcd->TextAcquireChar(glyphs[c]);
         else
-            lcd->special_chars.push_back(SpecialChar(lcd->YRES));
+            ch = lcd->TextAcquireChar(SpecialChar(lcd->YRES), false);
 
-        ch_[c] = lcd->special_chars.size() - 1;
+        if(ch < 0) {
+            update_ = -1;
+            LCDError("Widget %s - unable to allocate special chars. CHARS: %d, in use: %d, size: %d", 
+                name_.c_str(), lcd->CHARS, c, size);
+            return;
+        }
+        ch_[c] = ch;
         lcd->TextSpecialCharChanged(ch_[c]);
     }
 
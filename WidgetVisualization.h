@@ -97,6 +97,7 @@ class WidgetVisualization : public Widget {
         Json::Value *section, int row, int col, int layer);
     ~WidgetVisualization();
     void SetupChars();
+    int PlanChars(std::vector<SpecialChar> &glyphs);
     void Start();
     void Stop();
     int GetStyle() { return style_; }
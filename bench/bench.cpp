@@ -0,0 +1,256 @@
+/* $Id$
+ * $URL$
+ *
+ * Copyright (C) 2009 Scott Sibley <scott@starlon.net>
+ *
+ * This file is part of LCDControl.
+ *
+ * LCDControl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCDControl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCDControl.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks for the rendering kernels, each against the plain
+ * loop it replaced. Not part of the daemon; build it by hand from this
+ * directory with the flags the daemon is built with, e.g.
+ *
+ *   g++ -O2 -msse2 -I.. -o bench bench.cpp ../TextComposite.cpp \
+ *       ../GraphicComposite.cpp ../RGBA.cpp ../SpecialChar.cpp ../debug.cpp
+ *
+ * and again with -mavx2 to see the wider path. Every kernel's output is
+ * checked against its reference before it is timed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <map>
+#include <vector>
+
+#include "TextComposite.h"
+#include "GraphicComposite.h"
+#include "RGBA.h"
+#include "SpecialChar.h"
+
+using namespace LCD;
+
+#define BENCH_LAYERS 3
+
+/* results land here so the timed loops aren't optimized away */
+static volatile unsigned int bench_sink;
+
+static double Now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static void Report(const char *name, double us, int iterations,
+    const char *unit) {
+    printf("%-28s %10.3f us/%s\n", name, us / iterations, unit);
+}
+
+/* The per-cell rule TextComposite vectorizes: first non-blank layer. */
+static void TextCompositeRef(unsigned char *dst, unsigned char **layers,
+    int nlayers, int pos, int len) {
+    for(int n = 0; n < len; n++) {
+        dst[n] = ' ';
+        for(int l = 0; l < nlayers; l++) {
+            if(layers[l][pos + n] != ' ') {
+                dst[n] = layers[l][pos + n];
+                break;
+            }
+        }
+    }
+}
+
+static int BenchText() {
+    const int cells = 1 << 20;
+    const int iterations = 100;
+    std::vector<unsigned char> data[BENCH_LAYERS];
+    unsigned char *layers[BENCH_LAYERS];
+    std::vector<unsigned char> ref(cells), out(cells);
+
+    for(int l = 0; l < BENCH_LAYERS; l++) {
+        data[l].resize(cells);
+        for(int n = 0; n < cells; n++)
+            data[l][n] = rand() % 3 ? ' ' : 'A' + rand() % 26;
+        layers[l] = &data[l][0];
+    }
+
+    TextCompositeRef(&ref[0], layers, BENCH_LAYERS, 0, cells);
+    TextComposite(&out[0], layers, BENCH_LAYERS, 0, cells);
+    if(ref != out) {
+        printf("TextComposite: output differs from reference\n");
+        return 1;
+    }
+
+    double start = Now();
+    for(int i = 0; i < iterations; i++)
+        TextCompositeRef(&ref[0], layers, BENCH_LAYERS, 0, cells);
+    Report("text composite, scalar", Now() - start, iterations, "1M cells");
+
+    start = Now();
+    for(int i = 0; i < iterations; i++)
+        TextComposite(&out[0], layers, BENCH_LAYERS, 0, cells);
+    Report("text composite", Now() - start, iterations, "1M cells");
+    return 0;
+}
+
+/* The per-pixel blend GraphicComposite replaced: start at the topmost
+   opaque layer and lay each layer above it over the result. */
+static RGBA GraphicBlendRef(RGBA **layers, int nlayers, int pos, RGBA base) {
+    RGBA ret(base.R, base.G, base.B, 0x00);
+    int o = nlayers - 1;
+    for(int l = 0; l < nlayers; l++) {
+        if(layers[l][pos].A == 255) {
+            o = l;
+            break;
+        }
+    }
+    for(int l = o; l >= 0; l--) {
+        RGBA p = layers[l][pos];
+        if(p.A == 0)
+            continue;
+        if(p.A == 255) {
+            ret.R = p.R;
+            ret.G = p.G;
+            ret.B = p.B;
+        } else {
+            ret.R = (p.R * p.A + ret.R * (255 - p.A)) / 255;
+            ret.G = (p.G * p.A + ret.G * (255 - p.A)) / 255;
+            ret.B = (p.B * p.A + ret.B * (255 - p.A)) / 255;
+        }
+        ret.A = 0xff;
+    }
+    return ret;
+}
+
+static int BenchGraphic() {
+    const int pixels = 1 << 18;
+    const int iterations = 100;
+    RGBA base(0x80, 0x40, 0x20);
+    std::vector<RGBA> data[BENCH_LAYERS];
+    RGBA *layers[BENCH_LAYERS];
+    std::vector<RGBA> ref(pixels), out(pixels);
+
+    for(int l = 0; l < BENCH_LAYERS; l++) {
+        data[l].resize(pixels);
+        for(int n = 0; n < pixels; n++) {
+            int a = rand() % 3;
+            data[l][n] = RGBA(rand() & 0xff, rand() & 0xff, rand() & 0xff,
+                a == 0 ? 0 : a == 1 ? 255 : rand() & 0xff);
+        }
+        layers[l] = &data[l][0];
+    }
+
+    for(int n = 0; n < pixels; n++)
+        ref[n] = GraphicBlendRef(layers, BENCH_LAYERS, n, base);
+    GraphicComposite(&out[0], layers, BENCH_LAYERS, 0, pixels, base, false);
+    if(memcmp(&ref[0], &out[0], pixels * sizeof(RGBA))) {
+        printf("GraphicComposite: output differs from reference\n");
+        return 1;
+    }
+
+    double start = Now();
+    for(int i = 0; i < iterations; i++)
+        for(int n = 0; n < pixels; n++)
+            ref[n] = GraphicBlendRef(layers, BENCH_LAYERS, n, base);
+    Report("graphic composite, scalar", Now() - start, iterations,
+        "256k px");
+
+    start = Now();
+    for(int i = 0; i < iterations; i++)
+        GraphicComposite(&out[0], layers, BENCH_LAYERS, 0, pixels, base,
+            false);
+    Report("graphic composite", Now() - start, iterations, "256k px");
+    bench_sink = ref[pixels - 1].R + out[pixels - 1].R;
+    return 0;
+}
+
+/* SpecialChar as it was: rows in a map, compared through a copy of the
+   other side's map per row. */
+class MapChar {
+    std::map<int, int> chars_;
+    int size_;
+
+    public:
+    MapChar(int size) : size_(size) {
+        for(int i = 0; i < size; i++)
+            chars_[i] = 0;
+    }
+    std::map<int, int> Chars() const { return chars_; }
+    int &operator[](int i) { return chars_[i]; }
+    bool operator==(const MapChar &rhv) {
+        if(size_ != rhv.size_)
+            return false;
+        for(int i = 0; i < size_; i++)
+            if(chars_[i] != rhv.Chars()[i])
+                return false;
+        return true;
+    }
+    unsigned int Hash() const {
+        unsigned int hash = 2166136261u;
+        for(std::map<int, int>::const_iterator it = chars_.begin();
+            it != chars_.end(); it++)
+            hash = (hash ^ (unsigned int)it->second) * 16777619u;
+        return (hash ^ size_) * 16777619u;
+    }
+};
+
+/* One iteration: copy a glyph, edit a row, compare and hash it, as the
+   char cache does for every glyph a widget draws. */
+static int BenchSpecialChar() {
+    const int iterations = 1000000;
+    const int rows = 8;
+    SpecialChar glyph(rows), other(rows);
+    MapChar map_glyph(rows), map_other(rows);
+    unsigned int sink = 0;
+
+    for(int i = 0; i < rows; i++) {
+        glyph[i] = map_glyph[i] = rand() & 0x1f;
+        other[i] = map_other[i] = glyph[i];
+    }
+    if(glyph.Hash() != map_glyph.Hash()) {
+        printf("SpecialChar: hash differs from reference\n");
+        return 1;
+    }
+
+    double start = Now();
+    for(int i = 0; i < iterations; i++) {
+        MapChar copy = map_glyph;
+        copy[i % rows] ^= 1;
+        sink += (copy == map_other) + copy.Hash();
+    }
+    Report("special char, map", Now() - start, iterations / 1000, "1k ops");
+
+    start = Now();
+    for(int i = 0; i < iterations; i++) {
+        SpecialChar copy = glyph;
+        copy[i % rows] ^= 1;
+        sink += (copy == other) + copy.Hash();
+    }
+    Report("special char", Now() - start, iterations / 1000, "1k ops");
+    bench_sink = sink;
+    return 0;
+}
+
+int main() {
+    int failed = 0;
+    srand(1);
+    failed += BenchText();
+    failed += BenchGraphic();
+    failed += BenchSpecialChar();
+    return failed;
+}